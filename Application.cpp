@@ -5,6 +5,8 @@
 #include "classes/Othello.h"
 #include "classes/Connect4.h"
 #include "classes/Chess.h"
+#include "classes/PositionIndex.h"
+#include <chrono>
 
 namespace ClassGame {
         //
@@ -13,6 +15,77 @@ namespace ClassGame {
         Game *game = nullptr;
         bool gameOver = false;
         int gameWinner = -1;
+        // finished chess games are appended here for self-play / analysis
+        const char *archivePath = "chess_games.cga";
+        bool archiveGames = false;
+        GameArchiveWriter archive;
+        // zobrist index over the archive, shown next to the chess board
+        const char *indexPath = "chess_games.czi";
+        PositionIndex positionIndex;
+        bool triedIndex = false;
+        // how the last "Build Index" went, shown under the button; -1 until one runs
+        bool indexBuilt = false;
+        long long indexBuildMs = -1;
+        // polyglot book the chess AI plays from before it starts searching
+        const char *bookPath = "chess_book.bin";
+        OpeningBook openingBook;
+        bool bookBestMove = false;
+        // syzygy files, looked for once when the first chess game starts
+        const char *tablebasePath = "syzygy";
+        Tablebase tablebase;
+        bool triedTablebase = false;
+        // NNUE network the chess AI evaluates with instead of its own terms, loaded once
+        const char *networkPath = "chess_net.nnue";
+        NNUENetwork network;
+        bool triedNetwork = false;
+
+        //
+        // list the archived games that reached the position on the board
+        //
+        static void RenderPositionLookup(Chess *chess)
+        {
+            ImGui::Begin("Position Lookup");
+
+            if (!triedIndex) {
+                positionIndex.open(indexPath);
+                triedIndex = true;
+            }
+            if (ImGui::Button("Build Index")) {
+                positionIndex.close();
+                auto start = std::chrono::steady_clock::now();
+                bool built = PositionIndex::build(archivePath, indexPath);
+                auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+                indexBuilt = built;
+                indexBuildMs = (long long)elapsed.count();
+                positionIndex.open(indexPath);
+            }
+            if (indexBuildMs >= 0) {
+                ImGui::Text(indexBuilt ? "Built %s in %lld ms" : "Failed to build %s (%lld ms)", indexPath, indexBuildMs);
+            }
+
+            if (!positionIndex.isOpen()) {
+                ImGui::Text("No index (%s)", indexPath);
+                ImGui::End();
+                return;
+            }
+            ImGui::Text("%llu games, %llu positions", (unsigned long long)positionIndex.gameCount(), (unsigned long long)positionIndex.entryCount());
+
+            static std::vector<PositionPosting> postings;
+            uint64_t key = chess->positionKey();
+            auto start = std::chrono::steady_clock::now();
+            size_t found = positionIndex.lookup(key, postings, 20);
+            auto micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+            ImGui::Text("Key %016llx", (unsigned long long)key);
+            ImGui::Text("Reached in %zu games (%lld us)", found, (long long)micros.count());
+            for (const PositionPosting &posting : postings) {
+                ImGui::Text("  game %u, ply %u", posting.gameId, (unsigned)posting.ply);
+            }
+            if (found > postings.size()) {
+                ImGui::Text("  ... %zu more", found - postings.size());
+            }
+            ImGui::End();
+        }
 
         //
         // game starting point
@@ -63,20 +136,44 @@ namespace ClassGame {
                         game = new Connect4();
                         game->setUpBoard();
                     }
+                    ImGui::Checkbox("Archive Chess Games", &archiveGames);
+                    ImGui::Checkbox("Always Play Best Book Move", &bookBestMove);
                     if (ImGui::Button("Start Chess")) {
-                        game = new Chess();
+                        Chess *chess = new Chess();
+                        game = chess;
+                        if (openingBook.isOpen() || openingBook.open(bookPath)) {
+                            chess->setOpeningBook(&openingBook, bookBestMove ? BookSelectBest : BookSelectWeighted);
+                        }
+                        if (!triedTablebase) {
+                            tablebase.init(tablebasePath);
+                            triedTablebase = true;
+                        }
+                        if (tablebase.tableCount() > 0) {
+                            chess->setTablebase(&tablebase);
+                        }
+                        if (!triedNetwork) {
+                            network.load(networkPath);
+                            triedNetwork = true;
+                        }
+                        if (network.isLoaded()) {
+                            chess->setNetwork(&network);
+                        }
+                        if (archiveGames && (archive.isOpen() || archive.open(archivePath))) {
+                            game->setArchive(&archive);
+                        }
                         game->setUpBoard();
                     }
                 } else {
                     ImGui::Text("Current Player Number: %d", game->getCurrentPlayer()->playerNumber());
-                    std::string stateString = game->stateString();
+                    const std::string &stateString = game->cachedStateString();
                     int stride = game->_gameOptions.rowX;
                     int height = game->_gameOptions.rowY;
 
                     for(int y=0; y<height; y++) {
-                        ImGui::Text("%s", stateString.substr(y*stride,stride).c_str());
+                        if ((size_t)(y*stride) >= stateString.size()) break;
+                        ImGui::Text("%.*s", (int)std::min<size_t>(stride, stateString.size() - y*stride), stateString.data() + y*stride);
                     }
-                    ImGui::Text("Current Board State: %s", game->stateString().c_str());
+                    ImGui::Text("Current Board State: %s", stateString.c_str());
                 }
                 ImGui::End();
 
@@ -89,6 +186,10 @@ namespace ClassGame {
                     game->drawFrame();
                 }
                 ImGui::End();
+
+                if (Chess *chess = dynamic_cast<Chess *>(game)) {
+                    RenderPositionLookup(chess);
+                }
         }
 
         //
@@ -102,10 +203,12 @@ namespace ClassGame {
             {
                 gameOver = true;
                 gameWinner = winner->playerNumber();
+                game->archiveGameOver(gameWinner == 0 ? ArchiveResultFirstPlayerWins : ArchiveResultSecondPlayerWins);
             }
             if (game->checkForDraw()) {
                 gameOver = true;
                 gameWinner = -1;
+                game->archiveGameOver(ArchiveResultDraw);
             }
         }
 }
@@ -76,6 +76,18 @@ Player *Bit::getOwner()
 	return _owner;
 }
 
+void Bit::setOwner(Player *player)
+{
+	_owner = player;
+	BitHolder::touchBoard();
+}
+
+void Bit::setGameTag(int tag)
+{
+	_gameTag = tag;
+	BitHolder::touchBoard();
+}
+
 void Bit::moveTo(const ImVec2 &point)
 {
 	_destinationPosition = point;
@@ -1,6 +1,8 @@
 #include "BitHolder.h"
 #include "Bit.h"
 
+uint64_t BitHolder::_boardVersion = 1;
+
 BitHolder::~BitHolder()
 {
 }
@@ -18,6 +20,7 @@ Bit *BitHolder::bit()
 	if (_bit && _bit->getParent() != this && !_bit->getPickedUp())
 	{
 		_bit = nullptr;
+		touchBoard();
 	}
 	return _bit;
 }
@@ -36,6 +39,7 @@ void BitHolder::setBit(Bit *abit)
 		{
 			_bit->setParent(this);
 		}
+		touchBoard();
 	}
 }
 
@@ -45,6 +49,7 @@ void BitHolder::destroyBit()
 	{
 		delete _bit;
 		_bit = nullptr;
+		touchBoard();
 	}
 }
 
@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include "Sprite.h"
 #include "Bit.h"
 
@@ -58,7 +59,15 @@ public:
 		return Sprite::isMouseOver(mousePos);
 	};
 
+	// bumped whenever any holder's contents (or a held bit's tag/owner) change,
+	// so anything derived from the board can be cached until it moves
+	static uint64_t boardVersion() { return _boardVersion; }
+	static void touchBoard() { _boardVersion++; }
+
 protected:
 	Bit *_bit;
 	int _gameTag;
+
+private:
+	static uint64_t _boardVersion;
 };
@@ -1,11 +1,11 @@
 #pragma once
 
-#ifdef _MSC_VER
-#include <intrin.h>
-#endif
+#include <array>
+#include <bit>
 #include <iostream>
+#include <cstdint>
 
-/* enum ChessPiece
+enum ChessPiece
 {
     NoPiece,
     Pawn,
@@ -14,124 +14,219 @@
     Rook,
     Queen,
     King
-}; */
+};
+
+//
+// bitboard primitives, square 0 = a1 and square 63 = h8
+//
+// everything here is constexpr and sits on <bit>, which the compilers turn into
+// popcnt/tzcnt/lzcnt (or their MSVC intrinsics) where the target has them.
+// directional shifts mask off whatever would wrap round to the other side of
+// the board, and the Kogge-Stone fills flood a set of squares along one
+// direction until they run into something, which is what slider attacks are
+// made of.
+//
+
+// Define constants for ranks and files
+constexpr uint64_t FileA(0x0101010101010101ULL);
+constexpr uint64_t FileH(0x8080808080808080ULL);
+constexpr uint64_t NotAFile(0xFEFEFEFEFEFEFEFEULL); // A file mask
+constexpr uint64_t NotHFile(0x7F7F7F7F7F7F7F7FULL); // H file mask
+constexpr uint64_t Rank1(0x00000000000000FFULL); // Rank 1 mask
+constexpr uint64_t Rank3(0x0000000000FF0000ULL); // Rank 3 mask
+constexpr uint64_t Rank6(0x0000FF0000000000ULL); // Rank 6 mask
+constexpr uint64_t Rank8(0xFF00000000000000ULL); // Rank 8 mask
+
+// square deltas, white's point of view
+enum Direction
+{
+    North = 8,
+    South = -8,
+    East = 1,
+    West = -1,
+    NorthEast = 9,
+    NorthWest = 7,
+    SouthEast = -7,
+    SouthWest = -9
+};
+
+constexpr uint64_t squareMask(int square) { return 1ULL << square; }
+constexpr int fileOf(int square) { return square & 7; }
+constexpr int rankOf(int square) { return square >> 3; }
+
+constexpr int popCount(uint64_t bits) { return std::popcount(bits); }
+// index of the lowest/highest set bit; bits must not be empty
+constexpr int lowestBit(uint64_t bits) { return std::countr_zero(bits); }
+constexpr int highestBit(uint64_t bits) { return 63 - std::countl_zero(bits); }
+// clear the lowest set bit and return its index; bits must not be empty
+constexpr int popLowestBit(uint64_t& bits)
+{
+    const int square = std::countr_zero(bits);
+    bits &= bits - 1;
+    return square;
+}
+constexpr bool moreThanOne(uint64_t bits) { return (bits & (bits - 1)) != 0; }
+
+// every square one step along a direction, nothing wrapping across the a/h edge
+template <Direction D>
+constexpr uint64_t shiftBoard(uint64_t bits)
+{
+    if constexpr (D == North) return bits << 8;
+    else if constexpr (D == South) return bits >> 8;
+    else if constexpr (D == East) return (bits & NotHFile) << 1;
+    else if constexpr (D == West) return (bits & NotAFile) >> 1;
+    else if constexpr (D == NorthEast) return (bits & NotHFile) << 9;
+    else if constexpr (D == NorthWest) return (bits & NotAFile) << 7;
+    else if constexpr (D == SouthEast) return (bits & NotHFile) >> 7;
+    else return (bits & NotAFile) >> 9;
+}
+
+// Kogge-Stone occluded fill: the sliders plus every empty square they reach along D
+template <Direction D>
+constexpr uint64_t floodFill(uint64_t sliders, uint64_t empty)
+{
+    constexpr int step = D > 0 ? D : -D;
+    // an empty square that a step would wrap onto is treated as blocked
+    if constexpr (D == East || D == NorthEast || D == SouthEast) empty &= NotAFile;
+    if constexpr (D == West || D == NorthWest || D == SouthWest) empty &= NotHFile;
+    auto raw = [](uint64_t bits, int by) { return D > 0 ? bits << by : bits >> by; };
+    sliders |= empty & raw(sliders, step);
+    empty &= raw(empty, step);
+    sliders |= empty & raw(sliders, 2 * step);
+    empty &= raw(empty, 2 * step);
+    sliders |= empty & raw(sliders, 4 * step);
+    return sliders;
+}
+
+// squares the sliders attack along D: the fill, one step on to take in the blocker
+template <Direction D>
+constexpr uint64_t slideAttacks(uint64_t sliders, uint64_t empty)
+{
+    return shiftBoard<D>(floodFill<D>(sliders, empty));
+}
+
+constexpr uint64_t rookSlideAttacks(uint64_t sliders, uint64_t empty)
+{
+    return slideAttacks<North>(sliders, empty) | slideAttacks<South>(sliders, empty) |
+           slideAttacks<East>(sliders, empty) | slideAttacks<West>(sliders, empty);
+}
+
+constexpr uint64_t bishopSlideAttacks(uint64_t sliders, uint64_t empty)
+{
+    return slideAttacks<NorthEast>(sliders, empty) | slideAttacks<NorthWest>(sliders, empty) |
+           slideAttacks<SouthEast>(sliders, empty) | slideAttacks<SouthWest>(sliders, empty);
+}
 
-class BitboardElement {
+namespace BitboardTables
+{
+    using SquarePairTable = std::array<std::array<uint64_t, 64>, 64>;
+
+    // squares strictly between two squares (between), or the whole line through
+    // both edge to edge (line), empty for squares that share no rank, file or diagonal
+    constexpr SquarePairTable makePairTable(bool wholeLine)
+    {
+        SquarePairTable table{};
+        constexpr int fileSteps[8] = { 0, 0, 1, -1, 1, -1, 1, -1 };
+        constexpr int rankSteps[8] = { 1, -1, 0, 0, 1, 1, -1, -1 };
+        for (int from = 0; from < 64; from++) {
+            for (int direction = 0; direction < 8; direction++) {
+                // the ray out from 'from' and the one the other way, for the whole line
+                uint64_t ray = 0, back = 0;
+                for (int sign = 1; sign >= -1; sign -= 2) {
+                    int file = fileOf(from) + sign * fileSteps[direction];
+                    int rank = rankOf(from) + sign * rankSteps[direction];
+                    for (; file >= 0 && file < 8 && rank >= 0 && rank < 8;
+                         file += sign * fileSteps[direction], rank += sign * rankSteps[direction]) {
+                        (sign > 0 ? ray : back) |= squareMask(rank * 8 + file);
+                    }
+                }
+                uint64_t passed = 0;
+                for (uint64_t rest = ray; rest; ) {
+                    // walk the ray outward, nearest square first
+                    const int to = fileSteps[direction] + rankSteps[direction] * 8 > 0 ? lowestBit(rest) : highestBit(rest);
+                    rest &= ~squareMask(to);
+                    table[from][to] = wholeLine ? (ray | back | squareMask(from)) : passed;
+                    passed |= squareMask(to);
+                }
+            }
+        }
+        return table;
+    }
+
+    inline constexpr SquarePairTable between = makePairTable(false);
+    inline constexpr SquarePairTable line = makePairTable(true);
+}
+
+// squares strictly between two squares on a line, nothing if they aren't on one
+constexpr uint64_t betweenSquares(int a, int b) { return BitboardTables::between[a][b]; }
+// the whole line through two squares, nothing if they aren't on one
+constexpr uint64_t lineThrough(int a, int b) { return BitboardTables::line[a][b]; }
+
+class BitBoard {
   public:
-    // Constructors
-    BitboardElement()
+    constexpr BitBoard()
         : _data(0) { }
-    BitboardElement(uint64_t data)
+    constexpr BitBoard(uint64_t data)
         : _data(data) { }
 
     // Getters and Setters
-    uint64_t getData() const { return _data; }
-    void setData(uint64_t data) { _data = data; }
+    constexpr uint64_t getData() const { return _data; }
+    constexpr void setData(uint64_t data) { _data = data; }
+
+    constexpr bool empty() const { return _data == 0; }
+    constexpr int count() const { return popCount(_data); }
+    constexpr bool test(int square) const { return (_data & squareMask(square)) != 0; }
+    constexpr void set(int square) { _data |= squareMask(square); }
+    constexpr void clear(int square) { _data &= ~squareMask(square); }
+
+    // index of the least/most significant set bit, -1 if empty
+    constexpr int firstBit() const { return _data ? lowestBit(_data) : -1; }
+    constexpr int lastBit() const { return _data ? highestBit(_data) : -1; }
+    // remove the least significant set bit and return its index; must not be empty
+    constexpr int popFirst() { return popLowestBit(_data); }
+
+    template <Direction D>
+    constexpr BitBoard shifted() const { return BitBoard(shiftBoard<D>(_data)); }
 
     // Method to loop through each bit in the element and perform an operation on it.
     template <typename Func>
-    void forEachBit(Func func) const {
-        if (_data != 0) {
-            uint64_t tempData = _data;
-            while (tempData) {
-                int index = bitScanForward(tempData);
-                func(index);
-                tempData &= tempData - 1;
-            }
-        }
+    constexpr void forEachBit(Func func) const {
+        for (uint64_t bits = _data; bits; ) func(popLowestBit(bits));
     }
 
-    BitboardElement& operator|=(const uint64_t other) {
-        _data |= other;
-        return *this;
-    }
+    // for (int square : board) visits the set squares from a1 up
+    struct Iterator {
+        uint64_t bits;
+        constexpr int operator*() const { return lowestBit(bits); }
+        constexpr Iterator& operator++() { bits &= bits - 1; return *this; }
+        constexpr bool operator!=(const Iterator& other) const { return bits != other.bits; }
+    };
+    constexpr Iterator begin() const { return { _data }; }
+    constexpr Iterator end() const { return { 0 }; }
 
-    void printBitboard() {
+    void printBitboard() const {
         std::cout << "\n  a b c d e f g h\n";
         for (int rank = 7; rank >= 0; rank--) {
             std::cout << (rank + 1) << " ";
             for (int file = 0; file < 8; file++) {
-                int square = rank * 8 + file;
-                if (_data & (1ULL << square)) {
-                    std::cout << "X ";
-                } else {
-                    std::cout << ". ";
-                }
+                std::cout << (test(rank * 8 + file) ? "X " : ". ");
             }
             std::cout << (rank + 1) << "\n";
-            std::cout << std::flush;
         }
         std::cout << "  a b c d e f g h\n";
         std::cout << std::flush;
     }
 
-    BitboardElement& operator|=(const BitboardElement& other) {
-        _data |= other._data;
-        return *this;
-    }
-
-    BitboardElement& operator&=(const BitboardElement& other) {
-        _data &= other._data;
-        return *this;
-    }
-
-    BitboardElement& operator&=(uint64_t mask) {
-        _data &= mask;
-        return *this;
-    }
-
-    BitboardElement operator|(uint64_t mask) const {
-        return BitboardElement(_data | mask);
-    }
-
-    BitboardElement operator|(const BitboardElement& other) const {
-        return BitboardElement(_data | other._data);
-    }
-
-    BitboardElement operator&(uint64_t mask) const {
-        return BitboardElement(_data & mask);
-    }
-
-    BitboardElement operator&(const BitboardElement& other) const {
-        return BitboardElement(_data & other._data);
-    }
-
-    // Return index of least significant set bit
-    int firstBit() const {
-        if (_data == 0) return -1;
-    #if defined(_MSC_VER) && !defined(__clang__)
-        unsigned long index;
-        _BitScanForward64(&index, _data);
-        return index;
-    #else
-        return __builtin_ffsll(_data) - 1;
-    #endif
-    }
+    constexpr BitBoard& operator|=(const BitBoard& other) { _data |= other._data; return *this; }
+    constexpr BitBoard& operator&=(const BitBoard& other) { _data &= other._data; return *this; }
+    constexpr BitBoard& operator^=(const BitBoard& other) { _data ^= other._data; return *this; }
+    constexpr BitBoard operator|(const BitBoard& other) const { return BitBoard(_data | other._data); }
+    constexpr BitBoard operator&(const BitBoard& other) const { return BitBoard(_data & other._data); }
+    constexpr BitBoard operator^(const BitBoard& other) const { return BitBoard(_data ^ other._data); }
+    constexpr BitBoard operator~() const { return BitBoard(~_data); }
+    constexpr bool operator==(const BitBoard& other) const { return _data == other._data; }
+    constexpr bool operator!=(const BitBoard& other) const { return _data != other._data; }
 
 private:
     uint64_t    _data;
-
-    inline int bitScanForward(uint64_t bb) const {
-#if defined(_MSC_VER) && !defined(__clang__)
-        unsigned long index;
-        _BitScanForward64(&index, bb);
-        return index;
-#else
-        return __builtin_ffsll(bb) - 1;
-#endif
-    };
-
-};
-
-struct BitMove {
-    uint8_t from;
-    uint8_t to;
-    uint8_t piece;
-
-    BitMove(int f, int t, uint8_t p)
-        : from(f), to(t), piece(p) { }
-
-    BitMove() : from(0), to(0), piece(0) { }
 };
-
-using BitBoard = BitboardElement;
\ No newline at end of file
@@ -0,0 +1,260 @@
+#include "BookBuilder.h"
+#include "GameArchive.h"
+#include "MappedFile.h"
+#include "OpeningBook.h"
+#include "PGNReader.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <thread>
+
+static bool recordLess(const BookRecord& a, const BookRecord& b)
+{
+    if (a.key != b.key) return a.key < b.key;
+    return a.move < b.move;
+}
+
+// the side to move's share of the result, for a game result in archive terms
+static int scoreFor(ArchiveResult result, bool whiteMoved)
+{
+    if (result == ArchiveResultDraw) return 1;
+    bool whiteWon = result == ArchiveResultFirstPlayerWins;
+    return whiteWon == whiteMoved ? 2 : 0;
+}
+
+static ArchiveResult resultFromPGN(std::string_view result)
+{
+    if (result == "1-0") return ArchiveResultFirstPlayerWins;
+    if (result == "0-1") return ArchiveResultSecondPlayerWins;
+    if (result == "1/2-1/2") return ArchiveResultDraw;
+    return ArchiveResultUnknown;
+}
+
+BookBuilder::BookBuilder(const BookBuildOptions& options)
+    : _options(options), _gamesUsed(0), _entriesWritten(0)
+{
+}
+
+int BookBuilder::threadCount(size_t work) const
+{
+    int threads = _options.threads > 0 ? _options.threads : (int)std::max(1u, std::thread::hardware_concurrency());
+    return (int)std::min<size_t>(threads, std::max<size_t>(work, 1));
+}
+
+uint64_t BookBuilder::recordCount() const
+{
+    uint64_t count = 0;
+    for (const auto& run : _runs) count += run.size();
+    return count;
+}
+
+uint16_t BookBuilder::polyglotMove(const BitMove& move)
+{
+    int to = move.to();
+    if (move.type() == CastlingMove) to = to > move.from() ? move.from() + 3 : move.from() - 4;
+    // polyglot numbers promotions knight = 1 .. queen = 4
+    int promotion = move.type() == PromotionMove ? move.promotion() - Knight + 1 : 0;
+    return makePolyglotMove(move.from(), to, promotion);
+}
+
+bool BookBuilder::addArchive(const std::string& path)
+{
+    GameArchiveReader archive;
+    if (!archive.open(path)) return false;
+    size_t games = archive.gameCount();
+
+    // set up the shared move generation tables before the workers start
+    GameState warmup;
+    warmup.init(kStartingState, WHITE);
+
+    int threads = threadCount(games);
+    std::vector<std::vector<BookRecord>> runs(threads);
+    std::atomic<uint64_t> used{ 0 };
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+            size_t first = games * t / threads;
+            size_t last = games * (t + 1) / threads;
+            std::vector<BookRecord>& run = runs[t];
+            ArchivedGame game;
+            GameState state;
+            for (size_t id = first; id < last; id++) {
+                if (!archive.game(id, game) || game.result == ArchiveResultUnknown) continue;
+                state.init(game.startState.size() == 64 ? game.startState.data() : kStartingState, WHITE);
+                uint32_t plies = std::min<uint32_t>(game.plyCount, _options.maxPly);
+                for (uint32_t ply = 0; ply < plies; ply++) {
+                    // chess logs BitMoves; moveFor fills in the type for ones logged as bare squares
+                    BitMove logged(game.move(ply));
+                    if (state.pieceAt(logged.from()) == NoPiece) break;
+                    bool whiteMoved = state.color == WHITE;
+                    BitMove played = state.moveFor(logged.from(), logged.to(), logged.promotion());
+                    run.push_back({ state.hash, polyglotMove(played), (uint16_t)scoreFor(game.result, whiteMoved), 0 });
+                    state.pushMove(played);
+                }
+                used++;
+            }
+            std::sort(run.begin(), run.end(), recordLess);
+        });
+    }
+    for (std::thread& worker : workers) worker.join();
+
+    _gamesUsed += used;
+    for (auto& run : runs) {
+        if (!run.empty()) _runs.push_back(std::move(run));
+    }
+    return true;
+}
+
+//
+// collects one game's opening moves and scores them once the result is known
+//
+class BookPGNVisitor : public PGNVisitor
+{
+public:
+    BookPGNVisitor(std::vector<BookRecord>& run, int maxPly) : _run(run), _maxPly(maxPly) {}
+
+    bool beginGame() override
+    {
+        _moves.clear();
+        _whiteMoved.clear();
+        return true;
+    }
+    bool move(const GameState& position, const BitMove& move, std::string_view san) override
+    {
+        if ((int)_moves.size() >= _maxPly) return false;
+        _moves.push_back({ position.hash, BookBuilder::polyglotMove(move), 0, 0 });
+        _whiteMoved.push_back(position.color == WHITE);
+        return true;
+    }
+    void endGame(std::string_view result, const GameState& position) override
+    {
+        ArchiveResult archiveResult = resultFromPGN(result);
+        if (archiveResult == ArchiveResultUnknown || _moves.empty()) return;
+        for (size_t i = 0; i < _moves.size(); i++) {
+            _moves[i].score = (uint16_t)scoreFor(archiveResult, _whiteMoved[i]);
+            _run.push_back(_moves[i]);
+        }
+        games++;
+    }
+
+    uint64_t games = 0;
+
+private:
+    std::vector<BookRecord>& _run;
+    int _maxPly;
+    std::vector<BookRecord> _moves;
+    std::vector<bool> _whiteMoved;
+};
+
+bool BookBuilder::addPGN(const std::string& path)
+{
+    MappedFile file;
+    if (!file.open(path, true)) return false;
+    std::string_view text(reinterpret_cast<const char*>(file.data()), (size_t)file.size());
+
+    GameState warmup;
+    warmup.init(kStartingState, WHITE);
+
+    // cut the text into one slice per worker, each starting at a game's first tag
+    int threads = threadCount(text.size() / (1 << 20) + 1);
+    std::vector<size_t> cuts{ 0 };
+    for (int t = 1; t < threads; t++) {
+        size_t cut = text.find("\n\n[", std::max(cuts.back(), text.size() * t / threads));
+        if (cut == std::string_view::npos) break;
+        cuts.push_back(cut + 2);
+    }
+    cuts.push_back(text.size());
+    threads = (int)cuts.size() - 1;
+
+    std::vector<std::vector<BookRecord>> runs(threads);
+    std::vector<uint64_t> used(threads, 0);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+            PGNReader reader;
+            reader.setText(text.substr(cuts[t], cuts[t + 1] - cuts[t]));
+            BookPGNVisitor visitor(runs[t], _options.maxPly);
+            reader.read(visitor);
+            used[t] = visitor.games;
+            std::sort(runs[t].begin(), runs[t].end(), recordLess);
+        });
+    }
+    for (std::thread& worker : workers) worker.join();
+
+    for (int t = 0; t < threads; t++) {
+        _gamesUsed += used[t];
+        if (!runs[t].empty()) _runs.push_back(std::move(runs[t]));
+    }
+    return true;
+}
+
+bool BookBuilder::write(const std::string& path)
+{
+    // lay the runs end to end and merge neighbours pairwise, each round in parallel
+    std::vector<BookRecord> records;
+    records.reserve(recordCount());
+    std::vector<size_t> bounds{ 0 };
+    for (auto& run : _runs) {
+        records.insert(records.end(), run.begin(), run.end());
+        bounds.push_back(records.size());
+        std::vector<BookRecord>().swap(run);
+    }
+    _runs.clear();
+    while (bounds.size() > 2) {
+        std::vector<size_t> merged{ 0 };
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i + 2 < bounds.size(); i += 2) {
+            workers.emplace_back([&records, &bounds, i]() {
+                std::inplace_merge(records.begin() + bounds[i], records.begin() + bounds[i + 1], records.begin() + bounds[i + 2], recordLess);
+            });
+            merged.push_back(bounds[i + 2]);
+        }
+        for (std::thread& worker : workers) worker.join();
+        if (bounds.size() % 2 == 0) merged.push_back(bounds.back());
+        bounds.swap(merged);
+    }
+
+    // fold each (key, move) into one weight: 2 per win plus 1 per draw, like polyglot's make-book.
+    // a move that only ever lost ends up with no weight and is left out
+    std::vector<PolyglotEntry> entries;
+    std::vector<uint32_t> weights;
+    size_t i = 0;
+    while (i < records.size()) {
+        size_t positionEnd = i;
+        while (positionEnd < records.size() && records[positionEnd].key == records[i].key) positionEnd++;
+
+        size_t firstMove = weights.size();
+        uint32_t heaviest = 0;
+        for (size_t j = i; j < positionEnd;) {
+            size_t k = j;
+            uint32_t weight = 0;
+            while (k < positionEnd && records[k].move == records[j].move) weight += records[k++].score;
+            if ((int)(k - j) >= _options.minGames && weight > 0) {
+                entries.push_back({ records[j].key, records[j].move, 0, 0 });
+                weights.push_back(weight);
+                heaviest = std::max(heaviest, weight);
+            }
+            j = k;
+        }
+        // weights are 16 bit in the file, scale a popular position down to fit
+        for (size_t e = firstMove; e < weights.size(); e++) {
+            uint32_t weight = heaviest > 0xffff ? (uint32_t)((uint64_t)weights[e] * 0xffff / heaviest) : weights[e];
+            OpeningBook::writeEntry(entries[e], entries[e].key, entries[e].move, (uint16_t)std::max<uint32_t>(weight, 1));
+        }
+        i = positionEnd;
+    }
+    _entriesWritten = entries.size();
+    if (entries.empty()) return false;
+
+    std::string tempPath = path + ".tmp";
+    FILE* file = std::fopen(tempPath.c_str(), "wb");
+    if (!file) return false;
+    bool ok = std::fwrite(entries.data(), sizeof(PolyglotEntry), entries.size(), file) == entries.size();
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok) {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    std::remove(path.c_str());
+    return std::rename(tempPath.c_str(), path.c_str()) == 0;
+}
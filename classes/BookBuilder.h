@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "GameState.h"
+
+//
+// builds a polyglot opening book from archived games and PGN files
+//
+// every input is replayed in parallel; each worker emits one record per
+// (position, move) it sees within the first maxPly plies, already scored for
+// the side that moved, and sorts its own run. write() merges the runs pairwise
+// (one thread per pair each round), folds equal (key, move) records together
+// and writes the weights out as a .bin file that OpeningBook can probe.
+//
+
+struct BookBuildOptions
+{
+    int maxPly = 30;            // only the opening goes in the book
+    int minGames = 2;           // drop moves seen fewer times than this
+    int threads = 0;            // 0 uses every core
+};
+
+// one move seen in one game, 16 bytes so runs sort fast
+struct BookRecord
+{
+    uint64_t key;
+    uint16_t move;              // polyglot encoding
+    uint16_t score;             // 2 win, 1 draw, 0 loss, for the side that moved
+    uint32_t reserved;
+};
+
+class BookBuilder
+{
+public:
+    explicit BookBuilder(const BookBuildOptions& options = BookBuildOptions());
+
+    // games with an unknown result are skipped, they say nothing about a move
+    bool addArchive(const std::string& path);
+    bool addPGN(const std::string& path);
+
+    // merge everything added so far and write the book; false if nothing could be written
+    bool write(const std::string& path);
+
+    uint64_t gamesUsed() const { return _gamesUsed; }
+    uint64_t recordCount() const;
+    uint64_t entriesWritten() const { return _entriesWritten; }
+
+    // polyglot encoding of a move (castling becomes king takes rook)
+    static uint16_t polyglotMove(const BitMove& move);
+
+private:
+    int threadCount(size_t work) const;
+
+    BookBuildOptions _options;
+    std::vector<std::vector<BookRecord>> _runs;
+    uint64_t _gamesUsed;
+    uint64_t _entriesWritten;
+};
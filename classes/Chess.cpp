@@ -8,35 +8,13 @@
 #include "Bitboard.h"
 #include "ChessHelpers.h"
 #include <cstdint>
+#include <cstring>
 #include "ChessAI.h"
+#include "GameState.h"
 
-// Helper: mask for a square index
-inline uint64_t SquareMask(int idx) { return 1ULL << idx; }
-
-// Helpers: get file and rank of square index (0..63)
-inline int SquareFile(int sq) { return sq % 8; }
-inline int SquareRank(int sq) { return sq / 8; }
+// Helper: is a square index on the board
 inline bool SquareValid(int sq) { return sq >= 0 && sq < 64; }
 
-// pop least-significant bit from uint64_t and return its index (-1 if zero)
-static inline int pop_lsb(uint64_t &bb) {
-    if (bb == 0) return -1;
-#if defined(_MSC_VER) && !defined(__clang__)
-    unsigned long idx;
-    _BitScanForward64(&idx, bb);
-    bb &= bb - 1;
-    return (int)idx;
-#else
-    int idx = __builtin_ctzll(bb);
-    bb &= bb - 1;
-    return idx;
-#endif
-}
-
-// Convert your BitboardElement to raw uint64_t quickly
-static inline uint64_t bb_get(const BitBoard &b) { return b.getData(); }
-static inline void bb_set(BitBoard &b, uint64_t v) { b.setData(v); }
-
 // Test "is white" for a Bit (gameTag < 128 = white)
 static inline bool isWhitePiece(const Bit* bit) { return bit->gameTag() < 128; }
 static inline bool isBlackPiece(const Bit* bit) { return bit->gameTag() >= 128; }
@@ -53,8 +31,8 @@ Chess::Chess()
     _grid = new Grid(8, 8);
     _ai = new ChessAI(this);
 
-    for (int i = 0; i < 64; ++i) _boardArray[i] = 0;
-    _whiteToMoveInternal = true;
+    _legalMovesValid = false;
+    _highlightedTargets = 0;
 }
 
 Chess::~Chess()
@@ -102,7 +80,9 @@ void Chess::setUpBoard()
 
     setAIPlayer(1);
 
+    _legalMovesValid = false;
     startGame();
+    _gameState.init(cachedStateString().c_str(), WHITE);
 }
 
 void Chess::FENtoBoard(const std::string& fen) {
@@ -165,6 +145,9 @@ bool Chess::canBitMoveFrom(Bit &bit, BitHolder &src)
     if (curPlayerNumber == 0 && !pieceIsWhite) return false; // white to move, piece must be white
     if (curPlayerNumber == 1 && pieceIsWhite)  return false; // black to move, piece must be black
 
+    ChessSquare* fromSq = dynamic_cast<ChessSquare*>(&src);
+    if (fromSq) highlightLegalDestinations(fromSq->getSquareIndex());
+
     return true;
 }
 
@@ -174,20 +157,110 @@ bool Chess::canBitMoveFromTo(Bit &bit, BitHolder &src, BitHolder &dst)
     ChessSquare* toSq   = dynamic_cast<ChessSquare*>(&dst);
     if (!fromSq || !toSq) return false;
 
-    // Build the full move list for the side to move, then check membership.
-    auto allMoves = GenerateMoves();
+    return (legalDestinationsFrom(fromSq->getSquareIndex()) & squareMask(toSq->getSquareIndex())) != 0;
+}
 
-    int fromIndex = fromSq->getSquareIndex();
-    int toIndex = toSq->getSquareIndex();
+void Chess::buildLegalMoveTable()
+{
+    for (int i = 0; i < 64; ++i) _legalDestinations[i] = 0;
+
+    // the game position knows castling rights and en passant; the grid stays the
+    // truth if the two have drifted apart
+    Player* mover = getCurrentPlayer();
+    resyncGameState((mover && mover->playerNumber() == 1) ? BLACK : WHITE);
+    for (const BitMove &m : _gameState.generateAllMoves()) {
+        _legalDestinations[m.from()] |= squareMask(m.to());
+    }
+    _legalMovesValid = true;
+}
 
-    for (const Move &m : allMoves) {
-        if (m.startSquare == fromIndex && m.targetSquare == toIndex) return true;
+uint64_t Chess::legalDestinationsFrom(int fromIndex)
+{
+    if (!SquareValid(fromIndex)) return 0;
+    if (!_legalMovesValid) buildLegalMoveTable();
+    return _legalDestinations[fromIndex];
+}
+
+void Chess::highlightLegalDestinations(int fromIndex)
+{
+    clearBoardHighlights();
+    _highlightedTargets = legalDestinationsFrom(fromIndex);
+    for (int square : BitBoard(_highlightedTargets)) {
+        _grid->getSquareByIndex(square)->setLegalTarget(true);
+    }
+}
+
+void Chess::clearBoardHighlights()
+{
+    while (_highlightedTargets) {
+        _grid->getSquareByIndex(popLowestBit(_highlightedTargets))->setLegalTarget(false);
+    }
+}
+
+void Chess::endTurn()
+{
+    _legalMovesValid = false;
+    clearBoardHighlights();
+    recordGameMove();
+    Game::endTurn();
+}
+
+void Chess::recordGameMove()
+{
+    // the board logs bare squares, the AI a whole move; either way moveFor gives the move as played
+    BitMove logged(_pendingMove);
+    if (_pendingMove != kNoHistoryMove && _gameState.pieceAt(logged.from()) != NoPiece) {
+        BitMove move = _gameState.moveFor(logged.from(), logged.to(), logged.promotion());
+        _gameState.pushMove(move);
+        applySpecialMoveToGrid(move);
+        _pendingMove = move.raw();
+    }
+    Player* mover = getCurrentPlayer();
+    resyncGameState((mover && mover->playerNumber() == 0) ? BLACK : WHITE);
+}
+
+void Chess::resyncGameState(char sideToMove)
+{
+    // anything the moves can't explain (no move logged, a piece edited in) starts the key history over
+    const std::string &board = cachedStateString();
+    if (board.size() == 64 && (std::memcmp(_gameState.state, board.data(), 64) != 0 || _gameState.color != sideToMove)) {
+        _gameState.init(board.c_str(), sideToMove);
+    }
+}
+
+void Chess::applySpecialMoveToGrid(const BitMove& move)
+{
+    const int from = move.from();
+    const int to = move.to();
+    if (move.type() == CastlingMove) {
+        ChessSquare* rookFrom = _grid->getSquareByIndex(to > from ? to + 1 : to - 2);
+        ChessSquare* rookTo = _grid->getSquareByIndex(to > from ? to - 1 : to + 1);
+        Bit* rook = rookFrom->bit();
+        if (rook && !rookTo->bit()) {
+            rook->moveTo(rookTo->getPosition());
+            rook->setParent(rookTo);
+            rookFrom->setBit(nullptr);
+            rookTo->setBit(rook);
+        }
+    } else if (move.type() == EnPassantMove) {
+        _grid->getSquareByIndex(to > from ? to - 8 : to + 8)->destroyBit();
+    } else if (move.type() == PromotionMove) {
+        ChessSquare* square = _grid->getSquareByIndex(to);
+        if (!square->bit()) return;
+        int playerNumber = square->bit()->gameTag() < 128 ? 0 : 1;
+        square->destroyBit();
+        Bit* piece = PieceForPlayer(playerNumber, move.promotion());
+        square->setBit(piece);
+        piece->setParent(square);
+        piece->moveTo(square->getPosition());
+        piece->setPickedUp(false);
     }
-    return false;
 }
 
 void Chess::stopGame()
 {
+    clearBoardHighlights();
+    _legalMovesValid = false;
     _grid->forEachSquare([](ChessSquare* square, int x, int y) {
         square->destroyBit();
     });
@@ -208,12 +281,15 @@ Player* Chess::ownerAt(int x, int y) const
 
 Player* Chess::checkForWinner()
 {
-    return nullptr;
+    // the side to move is mated: no legal moves while in check
+    if (!_gameState.generateAllMoves().empty() || !_gameState.isInCheck()) return nullptr;
+    return getPlayerAt(_gameState.color == WHITE ? 1 : 0);
 }
 
 bool Chess::checkForDraw()
 {
-    return false;
+    if (_gameState.generateAllMoves().empty()) return !_gameState.isInCheck();
+    return _gameState.isRepetition(2) || _gameState.isFiftyMoveDraw();
 }
 
 std::string Chess::initialStateString()
@@ -244,246 +320,26 @@ void Chess::setStateString(const std::string &s)
     });
 }
 
-std::vector<Move> Chess::GenerateMoves() {
-    std::vector<Move> moves;
-    moves.reserve(128);
-
-    // Choose whether to use internal board (if internal inited) or grid:
-    bool useInternal = true;
-    // If internal board is all zeros then fall back to grid
-    bool anyPiece = false;
-    for (int i=0;i<64;i++) if (_boardArray[i] != 0) { anyPiece = true; break; }
-    if (!anyPiece) useInternal = false;
-
-    auto pieceAt = [&](int idx)->int {
-        if (useInternal) return _boardArray[idx];
-        ChessSquare* s = _grid->getSquareByIndex(idx);
-        if (!s) return 0;
-        Bit* b = s->bit();
-        return b ? b->gameTag() : 0;
-    };
-
-    auto pushMove = [&](int from, int to) {
-        Move m;
-        m.startSquare = from;
-        m.targetSquare = to;
-        moves.push_back(m);
-    };
-
-    // Iterate board squares
-    for (int sq = 0; sq < 64; ++sq)
-    {
-        int tag = pieceAt(sq);
-        if (tag == 0) continue;
-        bool white = tag < 128;
-        int pid = tag % 128;
-        // Respect side-to-move: if using internal board, consult _whiteToMoveInternal
-        if (useInternal) {
-            if (_whiteToMoveInternal != white) continue;
-        } else {
-            Player* cur = getCurrentPlayer();
-            if (cur) {
-                bool whiteToMove = cur->playerNumber() == 0;
-                if (whiteToMove != white) continue;
-            }
-        }
-
-        int file = SquareFile(sq);
-        int rank = SquareRank(sq);
-
-        auto isFriendly = [&](int idx)->bool {
-            int t = pieceAt(idx);
-            if (t == 0) return false;
-            return (t < 128) == white;
-        };
-        auto isEnemy = [&](int idx)->bool {
-            int t = pieceAt(idx);
-            if (t == 0) return false;
-            return (t < 128) != white;
-        };
-
-        // Pawn
-        if (pid == Pawn) {
-            if (white) {
-                int one = sq + 8;
-                if (SquareValid(one) && pieceAt(one) == 0) {
-                    pushMove(sq, one);
-                    // double from rank 1
-                    if (rank == 1) {
-                        int two = sq + 16;
-                        if (SquareValid(two) && pieceAt(two) == 0) pushMove(sq, two);
-                    }
-                }
-                // captures
-                if (file > 0) { int c = sq + 7; if (SquareValid(c) && isEnemy(c)) pushMove(sq, c); }
-                if (file < 7) { int c = sq + 9; if (SquareValid(c) && isEnemy(c)) pushMove(sq, c); }
-            } else { // black
-                int one = sq - 8;
-                if (SquareValid(one) && pieceAt(one) == 0) {
-                    pushMove(sq, one);
-                    if (rank == 6) {
-                        int two = sq - 16;
-                        if (SquareValid(two) && pieceAt(two) == 0) pushMove(sq, two);
-                    }
-                }
-                if (file > 0) { int c = sq - 9; if (SquareValid(c) && isEnemy(c)) pushMove(sq, c); }
-                if (file < 7) { int c = sq - 7; if (SquareValid(c) && isEnemy(c)) pushMove(sq, c); }
-            }
-        }
-        // Knight
-        else if (pid == Knight) {
-            constexpr int kNOff[8] = { +17, +15, +10, +6, -6, -10, -15, -17 };
-            for (int off : kNOff) {
-                int to = sq + off;
-                if (!SquareValid(to)) continue;
-                int tf = SquareFile(to);
-                if (std::abs(file - tf) > 2) continue;
-                if (isFriendly(to)) continue;
-                pushMove(sq, to);
-            }
-        }
-        // King
-        else if (pid == King) {
-            constexpr int kKOff[8] = { +1, -1, +8, -8, +9, +7, -9, -7 };
-            for (int off : kKOff) {
-                int to = sq + off;
-                if (!SquareValid(to)) continue;
-                int tf = SquareFile(to);
-                if (std::abs(file - tf) > 1) continue;
-                if (isFriendly(to)) continue;
-                pushMove(sq, to);
-            }
-        }
-        // Bishop / Rook / Queen (ray attacks)
-        else {
-            auto ray = [&](int dir) {
-                int cur = sq;
-                while (true) {
-                    int f = SquareFile(cur);
-                    int r = SquareRank(cur);
-                    int n = cur + dir;
-                    if (!SquareValid(n)) break;
-                    // file wrap checks for left/right moves
-                    int nf = SquareFile(n);
-                    if (std::abs(nf - f) > 2 && (dir == 1 || dir == -1 || dir == 7 || dir == -9 || dir == 9 || dir == -7)) {
-                        // wrap; break (defensive)
-                        break;
-                    }
-                    if (isFriendly(n)) break;
-                    pushMove(sq, n);
-                    if (isEnemy(n)) break;
-                    cur = n;
-                }
-            };
-            if (pid == Bishop || pid == Queen) {
-                // bishop directions: +9, +7, -7, -9 (on 0..63)
-                ray(+9); ray(+7); ray(-7); ray(-9);
-            }
-            if (pid == Rook || pid == Queen) {
-                // rook directions: +1, -1, +8, -8
-                ray(+1); ray(-1); ray(+8); ray(-8);
-            }
-        }
-    }
-
-    return moves;
-}
-
-void Chess::buildInternalBoardFromGrid()
-{
-    for (int i = 0; i < 64; ++i)
-        _boardArray[i] = 0;
-
-    _grid->forEachSquare([&](ChessSquare* square, int, int) {
-        int idx = square->getSquareIndex();
-        if (square->bit())
-            _boardArray[idx] = square->bit()->gameTag();
-    });
-
-    Player* cur = getCurrentPlayer();
-    _whiteToMoveInternal = (cur && cur->playerNumber() == 0);
-}
-
-// sync internal board back to the grid (after AI chooses move)
-void Chess::syncGridFromInternalBoard()
+int Chess::materialScore()
 {
-    for (int i = 0; i < 64; ++i)
-    {
-        ChessSquare* sq = _grid->getSquareByIndex(i);
-        int tag = _boardArray[i];
-        // Destroy whatever is in square and replace with correct piece
-        sq->destroyBit();
-        if (tag != 0)
-        {
-            // FIX START
-            // Tag < 128 is White (Player 0). Tag >= 128 is Black (Player 1).
-            int playerNumber = tag < 128 ? 0 : 1; 
-            int pieceId = tag % 128;
-            
-            // Pass playerNumber, not "isWhite" boolean logic
-            Bit* b = PieceForPlayer(playerNumber, (ChessPiece)pieceId);
-            // FIX END
-            
-            sq->setBit(b);
-            b->setParent(sq);
-            b->moveTo(sq->getPosition());
-            b->setPickedUp(false);
-            b->setGameTag(tag);
-        }
-    }
+    // attacks() brings the bitboards up to date with the board
+    _gameState.attacks();
+    return PieceSquare::material(_gameState);
 }
 
-int Chess::applyMoveToInternalBoard(const Move &m)
+void Chess::setTablebase(Tablebase* tablebase, int probeDepth, int pieceLimit)
 {
-    int from = m.startSquare;
-    int to   = m.targetSquare;
-
-    int captured = _boardArray[to];
-    _boardArray[to]   = _boardArray[from];
-    _boardArray[from] = 0;
-    
-    // FIX: Toggle the internal turn so the next depth of recursion 
-    // generates moves for the opponent.
-    _whiteToMoveInternal = !_whiteToMoveInternal; 
-
-    return captured;
+    if (_ai) _ai->setTablebase(tablebase, probeDepth, pieceLimit);
 }
 
-void Chess::undoMoveInInternalBoard(const Move &m, int captured)
+void Chess::setNetwork(const NNUENetwork* network)
 {
-    int from = m.startSquare;
-    int to   = m.targetSquare;
-
-    _boardArray[from] = _boardArray[to];
-    _boardArray[to]   = captured;
-
-    // FIX: Toggle it back when undoing
-    _whiteToMoveInternal = !_whiteToMoveInternal;
+    if (_ai) _ai->setNetwork(network);
 }
 
-int Chess::materialScore()
+void Chess::setOpeningBook(OpeningBook* book, BookSelection selection)
 {
-    int whiteScore = 0;
-    int blackScore = 0;
-    for (int i = 0; i < 64; ++i)
-    {
-        int tag = _boardArray[i];
-        if (tag == 0) continue;
-        bool white = tag < 128;
-        int id = tag % 128;
-        int val = 0;
-        switch (id) {
-            case Pawn: val = VAL_PAWN; break;
-            case Knight: val = VAL_KNIGHT; break;
-            case Bishop: val = VAL_BISHOP; break;
-            case Rook: val = VAL_ROOK; break;
-            case Queen: val = VAL_QUEEN; break;
-            case King: val = VAL_KING; break;
-            default: val = 0; break;
-        }
-        if (white) whiteScore += val; else blackScore += val;
-    }
-    return whiteScore - blackScore;
+    if (_ai) _ai->setOpeningBook(book, selection);
 }
 
 void Chess::makeAIMove(int depth)
@@ -494,21 +350,21 @@ void Chess::makeAIMove(int depth)
     Player* cur = getCurrentPlayer();
     if (!cur || !cur->isAIPlayer()) return;
 
-    // 2. Sync internal board so AI thinks based on current reality
-    buildInternalBoardFromGrid();
+    // 2. The AI searches the game position, so make sure it is the board on screen
+    resyncGameState(cur->playerNumber() == 1 ? BLACK : WHITE);
 
     // 3. Find the best move
-    Move bestMove = _ai->findBestMove(depth);
+    BitMove bestMove = _ai->findBestMove(depth);
 
-    // Safety: If AI returns invalid move, abort
-    if (bestMove.startSquare < 0 || bestMove.targetSquare < 0) return;
+    // Safety: If AI has no move, abort
+    if (bestMove.isNull()) return;
 
-    // 4. Update Internal State (for logic)
-    applyMoveToInternalBoard(bestMove);
+    // 4. The rook of a castle, a pawn taken en passant and a promotion are
+    // finished off by recordGameMove
 
     // 5. Update Visuals (The "Vanish" Fix)
-    ChessSquare* startSq = _grid->getSquareByIndex(bestMove.startSquare);
-    ChessSquare* endSq   = _grid->getSquareByIndex(bestMove.targetSquare);
+    ChessSquare* startSq = _grid->getSquareByIndex(bestMove.from());
+    ChessSquare* endSq   = _grid->getSquareByIndex(bestMove.to());
 
     // Safety check: ensure start square actually has a piece
     Bit* piece = startSq->bit();
@@ -533,7 +389,8 @@ void Chess::makeAIMove(int depth)
         piece->setPickedUp(false);
     }
     
-    // 6. End the turn
+    // 6. End the turn; a BitMove is laid out like a HistoryMove and is logged as is
+    _pendingMove = bestMove.raw();
     endTurn();
 }
 
@@ -4,40 +4,17 @@
 #include "Grid.h"
 #include <vector>
 #include "ChessSquare.h"
+#include "Bitboard.h"
+#include "GameState.h"
+#include "OpeningBook.h"
+#include "Tablebase.h"
+#include "NNUE.h"
+#include "PieceSquare.h"
 
 class ChessAI;
 
 constexpr int pieceSize = 80;
 
-enum ChessPiece
-{
-    NoPiece,
-    Pawn,
-    Knight,
-    Bishop,
-    Rook,
-    Queen,
-    King
-};
-
-constexpr int VAL_PAWN   = 100;
-constexpr int VAL_KNIGHT = 320;
-constexpr int VAL_BISHOP = 330;
-constexpr int VAL_ROOK   = 500;
-constexpr int VAL_QUEEN  = 900;
-constexpr int VAL_KING   = 20000;
-
-struct Move
-{
-    public: 
-        int startSquare;
-        int targetSquare;
-        int capturedPiece; // store captured piece id here
-
-        Move() : startSquare(-1), targetSquare(-1), capturedPiece(0) {}
-        Move(int s, int t) : startSquare(s), targetSquare(t), capturedPiece(0) {}
-};
-
 class Chess : public Game
 {
 public:
@@ -51,6 +28,8 @@ public:
     bool actionForEmptyHolder(BitHolder &holder) override;
 
     void stopGame() override;
+    void endTurn() override;
+    void clearBoardHighlights() override;
 
     Player *checkForWinner() override;
     bool checkForDraw() override;
@@ -61,16 +40,23 @@ public:
 
     Grid* getGrid() override { return _grid; }
 
-    std::vector<Move> moves;
-    std::vector<Move> GenerateMoves();
+    // white's material less black's in the game position
+    int materialScore();
 
-    int applyMoveToInternalBoard(const Move &m);
-    void undoMoveInInternalBoard(const Move &m, int captured);
+    // the game so far as a GameState: the position on the board plus the keys and
+    // halfmove clock the draw rules need
+    const GameState& gameState() const { return _gameState; }
 
-    int materialScore();
-    bool isWhiteToMove() const { return _whiteToMoveInternal; }
+    // zobrist key of the position on the board, same keys the position index uses
+    uint64_t positionKey() const { return _gameState.hash; }
 
     void makeAIMove(int depth = 3);
+    // the AI plays from this book while the position is in it
+    void setOpeningBook(OpeningBook* book, BookSelection selection = BookSelectWeighted);
+    // endgame tables for the AI, see ChessAI::setTablebase
+    void setTablebase(Tablebase* tablebase, int probeDepth = 1, int pieceLimit = 7);
+    // network evaluation for the AI, see ChessAI::setNetwork
+    void setNetwork(const NNUENetwork* network);
 
     bool gameHasAI() override;
 
@@ -80,11 +66,24 @@ private:
     void FENtoBoard(const std::string& fen);
     char pieceNotation(int x, int y) const;
 
-    int _boardArray[64];
-    bool _whiteToMoveInternal;
-
-    void buildInternalBoardFromGrid();
-    void syncGridFromInternalBoard();
+    // play the move that ended the turn into _gameState
+    void recordGameMove();
+    // start _gameState over from the grid if the two disagree
+    void resyncGameState(char sideToMove);
+    // the grid only moves the piece that was dropped; move the castling rook,
+    // take the pawn passed en passant and swap in the promoted piece
+    void applySpecialMoveToGrid(const BitMove& move);
+    GameState _gameState;
+
+    // legal destinations for the side to move, one bitboard per from-square.
+    // built on first use each turn and thrown away by endTurn
+    void buildLegalMoveTable();
+    uint64_t legalDestinationsFrom(int fromIndex);
+    void highlightLegalDestinations(int fromIndex);
+
+    uint64_t _legalDestinations[64];
+    bool _legalMovesValid;
+    uint64_t _highlightedTargets;
 
     Grid* _grid;
 
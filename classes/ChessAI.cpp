@@ -1,7 +1,33 @@
 #include "ChessAI.h"
 #include "Chess.h"
-#include <limits>
+#include "Endgame.h"
+#include "EvalTerms.h"
 #include <algorithm>
+#include <cstdlib>
+
+// mate scores count down with distance, so a shorter mate always scores higher
+static constexpr int kMateScore = 30000;
+// tablebase wins score below any mate but above any material count
+static constexpr int kTablebaseWin = 15000;
+// wider than any score, for windows that shut nothing out
+static constexpr int kInfinity = kMateScore + 1;
+// check extensions stop adding plies this far from the root
+static constexpr int kMaxPly = 64;
+// nodes this deep with no hash move are searched a ply shallower
+static constexpr int kReductionDepth = 4;
+// entries in the hash move table, a power of two
+static constexpr size_t kHashMoveEntries = 1 << 16;
+
+static constexpr int kPieceValue[7] = { 0, VAL_PAWN, VAL_KNIGHT, VAL_BISHOP, VAL_ROOK, VAL_QUEEN, VAL_KING };
+
+// score for a side-to-move tablebase result; sooner wins and later losses score better
+static int tablebaseScore(int wdl, int ply)
+{
+    if (wdl == TablebaseWin) return kTablebaseWin - ply;
+    if (wdl == TablebaseLoss) return -kTablebaseWin + ply;
+    // cursed wins and blessed losses are draws under the fifty-move rule
+    return 0;
+}
 
 /* // piece values (tunable)
 static constexpr int VAL_PAWN = 100;
@@ -12,77 +38,390 @@ static constexpr int VAL_QUEEN = 900;
 static constexpr int VAL_KING = 20000; */
 
 ChessAI::ChessAI(Chess* game)
-    : _game(game), _searchDepth(3)
+    : _game(game), _searchDepth(3), _hashMoves(kHashMoveEntries)
 {
 }
 
-Move ChessAI::findBestMove(int depth)
+BitMove ChessAI::findBestMove(int depth)
 {
     _searchDepth = depth;
-    std::vector<Move> moves = _game->GenerateMoves();
-    if (moves.empty()) return Move();
+    // search a copy of the game position; it carries the key history for repetitions
+    _position = _game->gameState();
+
+    BitMove bookMove;
+    if (probeBook(bookMove)) return bookMove;
+    if (probeTablebaseRoot(bookMove)) return bookMove;
 
-    int bestScore = std::numeric_limits<int>::min();
-    Move best = moves[0];
+    std::vector<BitMove> moves = _position.generateAllMoves();
+    if (moves.empty()) return BitMove();
 
-    for (const Move &m : moves)
+    _accumulatorPly = 0;
+    if (useNetwork()) {
+        if (_accumulators.empty()) _accumulators.resize(kMaxPly);
+        _network->refresh(_position, _accumulators[0]);
+    }
+
+    // deepen a ply at a time: each pass leaves its best moves in the hash move table
+    // for the next one to search first, and costs little next to the last pass
+    BitMove best = moves[0];
+    for (int iteration = 1; iteration <= _searchDepth; iteration++)
     {
-        int captured = _game->applyMoveToInternalBoard(m);
-        int score = -negamax(_searchDepth - 1, std::numeric_limits<int>::min()/2, std::numeric_limits<int>::max()/2, false);
-        _game->undoMoveInInternalBoard(m, captured);
-        if (score > bestScore)
+        orderMoves(moves, best);
+        int alpha = -kInfinity;
+        for (size_t i = 0; i < moves.size(); i++)
         {
-            bestScore = score;
-            best = m;
+            makeMove(moves[i]);
+            int score;
+            if (i == 0) {
+                score = -negamax(iteration - 1, 1, -kInfinity, -alpha);
+            } else {
+                score = -negamax(iteration - 1, 1, -alpha - 1, -alpha);
+                if (score > alpha) score = -negamax(iteration - 1, 1, -kInfinity, -alpha);
+            }
+            unmakeMove();
+            if (score > alpha)
+            {
+                alpha = score;
+                best = moves[i];
+            }
         }
     }
     return best;
 }
 
-int ChessAI::negamax(int depth, int alpha, int beta, bool maximizingPlayer)
+bool ChessAI::probeBook(BitMove& move)
+{
+    if (!_book || !_book->isOpen()) return false;
+
+    BookMove entry;
+    if (!_book->probe(_position.hash, entry, _bookSelection)) return false;
+
+    // polyglot writes castling as the king capturing its rook
+    int to = entry.to;
+    if (_position.pieceAt(entry.from) == King && (to == entry.from + 3 || to == entry.from - 4)) {
+        to = to > entry.from ? entry.from + 2 : entry.from - 2;
+    }
+
+    // only play it if it's legal here, a key collision must never make an illegal move
+    for (const BitMove& m : _position.generateAllMoves()) {
+        if (m.type() == PromotionMove && m.promotion() != Knight + entry.promotion - 1) continue;
+        if (m.from() == entry.from && m.to() == to) {
+            move = m;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ChessAI::tablebaseCovers() const
+{
+    if (!_tablebase) return false;
+    int limit = std::min(_tablebasePieces, _tablebase->maxPieces());
+    return limit > 0 && _position.pieceCount() <= limit;
+}
+
+bool ChessAI::probeTablebaseRoot(BitMove& move)
+{
+    if (!tablebaseCovers()) return false;
+
+    // rank every move by the result it leaves the opponent with, then by distance to zeroing:
+    // win as fast as possible, lose as slowly as possible
+    std::vector<BitMove> moves = _position.generateAllMoves();
+    bool found = false;
+    int bestWDL = 0, bestDTZ = 0;
+    for (const BitMove& m : moves) {
+        _position.pushMove(m);
+        int wdl, dtz;
+        bool probed = _tablebase->probeWDL(_position, wdl) && _tablebase->probeDTZ(_position, dtz);
+        const bool mates = _position.isInCheck() && _position.generateAllMoves().empty();
+        // a capture or pawn move zeroes the count itself, the nearest a zeroing move can be
+        const bool zeroing = _position.halfmoveClock == 0;
+        _position.popMove();
+        if (!probed) return false;
+        if (mates) {
+            move = m;
+            return true;
+        }
+
+        wdl = -wdl;
+        dtz = zeroing ? (wdl > 0 ? 1 : wdl < 0 ? -1 : 0) : -dtz;
+        bool better = !found || wdl > bestWDL ||
+                      (wdl == bestWDL && (wdl > 0 ? std::abs(dtz) < std::abs(bestDTZ) : std::abs(dtz) > std::abs(bestDTZ)));
+        if (better) {
+            found = true;
+            bestWDL = wdl;
+            bestDTZ = dtz;
+            move = m;
+        }
+    }
+    return found;
+}
+
+int ChessAI::negamax(int depth, int ply, int alpha, int beta)
 {
-    if (depth == 0)
+    // a position seen before (in the game or on this line) is a draw, so the search
+    // stops walking in circles
+    if (_position.isRepetition())
+    {
+        return 0;
+    }
+    // so is a spent fifty-move count, unless the move that spent it gave mate
+    if (_position.isFiftyMoveDraw())
+    {
+        return _position.isInCheck() && _position.generateAllMoves().empty() ? -kMateScore + ply : 0;
+    }
+
+    // no line from here can beat a mate already found closer to the root
+    alpha = std::max(alpha, -kMateScore + ply);
+    beta = std::min(beta, kMateScore - ply - 1);
+    if (alpha >= beta)
+    {
+        return alpha;
+    }
+
+    // a check is searched a ply deeper, so a forcing line isn't cut off halfway
+    const bool inCheck = _position.isInCheck();
+    if (inCheck && ply < kMaxPly) depth++;
+
+    if (depth <= 0 || ply >= kMaxPly)
     {
-        return evaluateBoard();
+        return quiesce(ply, alpha, beta);
     }
 
-    std::vector<Move> moves = _game->GenerateMoves();
+    if (depth >= _tablebaseDepth && tablebaseCovers()) {
+        int wdl;
+        if (_tablebase->probeWDL(_position, wdl)) return tablebaseScore(wdl, ply);
+    }
+
+    std::vector<BitMove> moves = _position.generateAllMoves();
     if (moves.empty())
     {
-        return 0;
+        // checkmated here, ply moves from the root, or stalemate
+        return inCheck ? -kMateScore + ply : 0;
     }
 
-    int best = std::numeric_limits<int>::min();
+    // with no earlier best move to go on, a shallower search is cheaper than a bad guess
+    // and leaves a hash move for the next visit
+    const BitMove hashMove = probeHashMove();
+    if (hashMove.isNull() && depth >= kReductionDepth) depth--;
+    orderMoves(moves, hashMove);
 
-    for (const Move &m : moves)
+    int best = -kInfinity;
+    BitMove bestMove = moves[0];
+
+    for (size_t i = 0; i < moves.size(); i++)
     {
-        int captured = _game->applyMoveToInternalBoard(m);
-        int val = -negamax(depth - 1, -beta, -alpha, !maximizingPlayer);
-        _game->undoMoveInInternalBoard(m, captured);
+        makeMove(moves[i]);
+        int val;
+        if (i == 0) {
+            val = -negamax(depth - 1, ply + 1, -beta, -alpha);
+        } else {
+            // principal variation search: the rest only have to be shown no better than
+            // the first, which a null window does cheaply; one that is gets searched again
+            val = -negamax(depth - 1, ply + 1, -alpha - 1, -alpha);
+            if (val > alpha && val < beta) val = -negamax(depth - 1, ply + 1, -beta, -alpha);
+        }
+        unmakeMove();
 
-        if (val > best) best = val;
+        if (val > best)
+        {
+            best = val;
+            bestMove = moves[i];
+        }
         if (val > alpha) alpha = val;
         if (alpha >= beta) break;
     }
+    storeHashMove(bestMove);
     return best;
 }
 
+void ChessAI::makeMove(const BitMove& move)
+{
+    if (useNetwork()) {
+        // quiescence can run past kMaxPly, so the stack grows as it needs to
+        if (_accumulatorPly + 1 == _accumulators.size()) _accumulators.emplace_back();
+        _network->update(_position, move, _accumulators[_accumulatorPly], _accumulators[_accumulatorPly + 1]);
+        _accumulatorPly++;
+    }
+    _position.pushMove(move);
+}
+
+void ChessAI::unmakeMove()
+{
+    _position.popMove();
+    if (useNetwork()) _accumulatorPly--;
+}
+
+BitMove ChessAI::probeHashMove() const
+{
+    const HashMove& entry = _hashMoves[_position.hash & (kHashMoveEntries - 1)];
+    return entry.key == _position.hash ? entry.move : BitMove();
+}
+
+void ChessAI::storeHashMove(const BitMove& move)
+{
+    _hashMoves[_position.hash & (kHashMoveEntries - 1)] = { _position.hash, move };
+}
+
+// the move to try first, then captures and queen promotions biggest victim first and
+// cheapest attacker first among equals, then the quiet moves as generated
+void ChessAI::orderMoves(std::vector<BitMove>& moves, const BitMove& first)
+{
+    auto order = [&](const BitMove& m) {
+        if (m == first) return 1000;
+        if (m.type() == PromotionMove && m.promotion() == Queen) return Queen * 8 + 8;
+        ChessPiece victim = m.type() == EnPassantMove ? Pawn : _position.pieceAt(m.to());
+        return victim == NoPiece ? 0 : victim * 8 - _position.pieceAt(m.from()) + 8;
+    };
+    std::stable_sort(moves.begin(), moves.end(), [&](const BitMove& a, const BitMove& b) { return order(a) > order(b); });
+}
+
+// captures only, until nothing is left hanging; the side to move may also stand pat
+// on the static score, since it's never forced to take. in check it has to answer
+// the check instead, so every evasion is searched and having none is mate
+int ChessAI::quiesce(int ply, int alpha, int beta)
+{
+    if (_position.isInCheck()) {
+        std::vector<BitMove> evasions = _position.generateAllMoves();
+        if (evasions.empty()) return -kMateScore + ply;
+        orderMoves(evasions, BitMove());
+
+        for (const BitMove& m : evasions)
+        {
+            makeMove(m);
+            int score = -quiesce(ply + 1, -beta, -alpha);
+            unmakeMove();
+
+            if (score >= beta) return score;
+            alpha = std::max(alpha, score);
+        }
+        return alpha;
+    }
+
+    int standPat = evaluateBoard();
+    if (standPat >= beta) return standPat;
+    alpha = std::max(alpha, standPat);
+
+    std::vector<BitMove> captures = _position.generateMoves(GenCaptures);
+    orderMoves(captures, BitMove());
+
+    for (const BitMove& m : captures)
+    {
+        // a capture that loses material once the exchange plays out can't raise alpha
+        if (m.type() != PromotionMove && see(m) < 0) continue;
+
+        makeMove(m);
+        int score = -quiesce(ply + 1, -beta, -alpha);
+        unmakeMove();
+
+        if (score >= beta) return score;
+        alpha = std::max(alpha, score);
+    }
+    return alpha;
+}
+
 int ChessAI::evaluateBoard()
 {
-    // simple material + mobility
+    // transpositions and the quiescence stand pat come back to the same positions
+    int score;
+    if (_evalCache.probe(_position.hash, score)) return score;
+    score = evaluatePosition();
+    _evalCache.store(_position.hash, score);
+    return score;
+}
+
+int ChessAI::evaluatePosition()
+{
+    // known endings (KPK, KQK, KRK, KBNK, no mating material) have their own scores
+    if (_position.pieceCount() <= 4) {
+        int score;
+        if (Endgame::evaluate(_position, score)) return score * _position.color;
+    }
+
+    if (useNetwork()) return _network->evaluate(_accumulators[_accumulatorPly], _position.color);
+
+    // material and square bonuses + mobility + king safety + pawn structure, from the side to move's point of view
     int material = evaluateMaterial();
     int mobility = evaluateMobility();
-    return material + mobility;
+    int kingSafety = evaluateKingSafety();
+    int pawns = evaluatePawns();
+    return material + mobility + kingSafety + pawns;
+}
+
+int ChessAI::evaluateMaterial()
+{
+    _position.attacks();
+    return PieceSquare::evaluate(_position) * _position.color;
+}
+
+// squares the minor and major pieces reach that aren't blocked by their own side,
+// side to move less the opponent, read off the attack map
+int ChessAI::evaluateMobility()
+{
+    return EvalTerms::mobility(_position) * kMobilityWeight * _position.color;
+}
+
+// enemy attacks on the squares around each king
+int ChessAI::evaluateKingSafety()
+{
+    return -EvalTerms::kingZoneAttacks(_position) * kKingZoneAttack * _position.color;
 }
 
-int ChessAI::evaluateMaterial() const
+// pawn structure out of the pawn table, plus what pieces do to the passed pawns it found
+int ChessAI::evaluatePawns()
 {
-    return _game->materialScore();
+    _position.attacks();
+    const PawnEntry& entry = _pawnTable.probe(_position._bitboards[WHITE_PAWNS].getData(),
+                                              _position._bitboards[BLACK_PAWNS].getData());
+    int score = entry.score - EvalTerms::blockedPassers(_position, entry.passed) * kBlockedPassedPawn;
+    return score * _position.color;
 }
 
-int ChessAI::evaluateMobility() const
+// static exchange evaluation: what the side to move nets from a capture if both
+// sides keep retaking on that square with their cheapest piece, either free to stop
+int ChessAI::see(const BitMove& move)
 {
-    std::vector<Move> moves = _game->GenerateMoves();
-    int mcount = (int)moves.size();
-    return mcount * 2; 
-}
\ No newline at end of file
+    _position.attacks();
+    const int to = move.to();
+    const uint64_t occupied = _position._bitboards[OCCUPANCY].getData();
+    uint64_t occupancy = occupied ^ (1ULL << move.from());
+    if (move.type() == EnPassantMove) occupancy ^= 1ULL << (_position.color == WHITE ? to - 8 : to + 8);
+
+    int gain[32];
+    int depth = 0;
+    gain[0] = kPieceValue[move.type() == EnPassantMove ? Pawn : _position.pieceAt(to)];
+    ChessPiece onSquare = _position.pieceAt(move.from());
+    int side = _position.color == WHITE ? 1 : 0;     // who retakes next
+
+    while (depth < 31) {
+        // pieces that moved are gone from the occupancy, which lets x-rays behind them through
+        const uint64_t attackers = _position.attackersTo(to, occupancy) & occupancy;
+        const int base = side == 0 ? WHITE_PAWNS : BLACK_PAWNS;
+        ChessPiece next = NoPiece;
+        uint64_t from = 0;
+        for (int piece = Pawn; piece <= King; piece++) {
+            from = attackers & _position._bitboards[base + piece - Pawn].getData();
+            if (from) {
+                next = static_cast<ChessPiece>(piece);
+                break;
+            }
+        }
+        if (next == NoPiece) break;
+
+        depth++;
+        gain[depth] = kPieceValue[onSquare] - gain[depth - 1];
+        // a take that loses even if nothing comes back is never made, so the exchange stops short of it
+        if (std::max(-gain[depth - 1], gain[depth]) < 0) {
+            depth--;
+            break;
+        }
+        occupancy ^= from & (0 - from);
+        onSquare = next;
+        side ^= 1;
+    }
+    while (depth > 0) {
+        gain[depth - 1] = -std::max(-gain[depth - 1], gain[depth]);
+        depth--;
+    }
+    return gain[0];
+}
@@ -2,8 +2,13 @@
 #include <vector>
 #include <cstdint>
 #include "Bitboard.h"
-
-struct Move;
+#include "GameState.h"
+#include "EvalCache.h"
+#include "NNUE.h"
+#include "OpeningBook.h"
+#include "PawnTable.h"
+#include "PieceSquare.h"
+#include "Tablebase.h"
 
 class Chess;
 
@@ -11,17 +16,80 @@ class ChessAI {
 public:
     ChessAI(Chess* game);
 
-    Move findBestMove(int depth);
+    // best move for the side to move in the game, a null move if there is none
+    BitMove findBestMove(int depth);
 
+    // score of the search position for the side to move
     int evaluateBoard();
 
     void setSearchDepth(int d) { _searchDepth = d; }
 
+    // book consulted before searching; nullptr turns it off
+    void setOpeningBook(OpeningBook* book, BookSelection selection = BookSelectWeighted) { _book = book; _bookSelection = selection; }
+
+    // endgame tables, probed at the root and at nodes with at least probeDepth plies left
+    // once the board is down to pieceLimit pieces; nullptr turns them off
+    void setTablebase(Tablebase* tablebase, int probeDepth = 1, int pieceLimit = 7)
+    {
+        _tablebase = tablebase;
+        _tablebaseDepth = probeDepth;
+        _tablebasePieces = pieceLimit;
+    }
+
+    // network evaluation in place of the hand-written terms; nullptr, or a network
+    // that didn't load, turns it off
+    void setNetwork(const NNUENetwork* network)
+    {
+        _network = network;
+        _evalCache.clear();
+    }
+
 private:
     Chess* _game;
     int _searchDepth;
+    GameState _position;
+    OpeningBook* _book = nullptr;
+    BookSelection _bookSelection = BookSelectWeighted;
+
+    Tablebase* _tablebase = nullptr;
+    int _tablebaseDepth = 1;
+    int _tablebasePieces = 7;
+
+    // best move found in a position, by key, searched first when the position comes up again
+    struct HashMove {
+        uint64_t key;
+        BitMove move;
+    };
+    std::vector<HashMove> _hashMoves;
+
+    PawnTable _pawnTable;
+    EvalCache _evalCache;
+
+    const NNUENetwork* _network = nullptr;
+    // an accumulator per ply from the root, each worked out from the one before it
+    std::vector<NNUEAccumulator> _accumulators;
+    size_t _accumulatorPly = 0;
+    bool useNetwork() const { return _network && _network->isLoaded(); }
+    // pushMove/popMove on the search position, keeping the accumulators in step
+    void makeMove(const BitMove& move);
+    void unmakeMove();
+
+    BitMove probeHashMove() const;
+    void storeHashMove(const BitMove& move);
+    void orderMoves(std::vector<BitMove>& moves, const BitMove& first);
+
+    bool probeBook(BitMove& move);
+    bool tablebaseCovers() const;
+    bool probeTablebaseRoot(BitMove& move);
 
-    int negamax(int depth, int alpha, int beta, bool maximizingPlayer);
-    int evaluateMaterial() const;
-    int evaluateMobility() const;
+    int negamax(int depth, int ply, int alpha, int beta);
+    int quiesce(int ply, int alpha, int beta);
+    // evaluateBoard worked out afresh, skipping the cache
+    int evaluatePosition();
+    int evaluateMaterial();
+    int evaluateMobility();
+    int evaluateKingSafety();
+    int evaluatePawns();
+    // material the side to move comes out ahead by after the exchange a capture starts
+    int see(const BitMove& move);
 };
\ No newline at end of file
@@ -10,6 +10,7 @@ public:
     {
         _column = 0;
         _row = 0;
+        _legalTarget = false;
     }
     // initialize the holder with a position, color, and a sprite
     void initHolder(const ImVec2 &position, const char *spriteName, const int column, const int row);
@@ -19,6 +20,9 @@ public:
     std::string getNotation() { return _notation; }
     void setNotation(std::string notation) { _notation = notation; }
     void setHighlighted(bool highlight) override;
+    // tint the square as a legal destination for the piece being dragged
+    void setLegalTarget(bool legal);
+    bool isLegalTarget() const { return _legalTarget; }
 
     int getDistance(const ChessSquare &other)
     {
@@ -31,11 +35,13 @@ public:
     int getSquareIndex() const { return _row * 8 + _column; }
 
 private:
+    void updateColor();
     ImVec4 Lerp(ImVec4 a, ImVec4 b, float t)
     {
         return ImVec4(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t, a.w + (b.w - a.w) * t);
     }
     int _column;
     int _row;
+    bool _legalTarget;
     std::string _notation;
 };
@@ -0,0 +1,226 @@
+#include "Endgame.h"
+#include <algorithm>
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+
+// scores for won endings sit above any plain material count but below tablebase wins
+static constexpr int kKnownWin = 10000;
+
+static inline int distance(int a, int b)
+{
+    return std::max(std::abs(fileOf(a) - fileOf(b)), std::abs(rankOf(a) - rankOf(b)));
+}
+
+static constexpr uint64_t kingAttacks(int square)
+{
+    const uint64_t king = squareMask(square);
+    const uint64_t row = king | shiftBoard<East>(king) | shiftBoard<West>(king);
+    return (row | shiftBoard<North>(row) | shiftBoard<South>(row)) & ~king;
+}
+
+static constexpr uint64_t pawnAttacks(int square)
+{
+    return shiftBoard<NorthWest>(squareMask(square)) | shiftBoard<NorthEast>(squareMask(square));
+}
+
+//
+// KPK bitbase
+//
+// positions are indexed by side to move, both kings and the pawn (files a-d,
+// ranks 2-7). every position starts out invalid, decided or unknown, and the
+// unknown ones are revisited until a pass changes nothing: a position is won
+// for white if some white move reaches a won position, and drawn for black if
+// some black move reaches a drawn one.
+//
+namespace
+{
+    constexpr int kKPKSize = 2 * 24 * 64 * 64;
+
+    enum KPKResult : uint8_t
+    {
+        KPKInvalid = 0,
+        KPKUnknown = 1,
+        KPKDraw = 2,
+        KPKWin = 4
+    };
+
+    inline int kpkIndex(bool whiteToMove, int blackKing, int whiteKing, int pawn)
+    {
+        return whiteKing | (blackKing << 6) | ((whiteToMove ? 0 : 1) << 12) | (fileOf(pawn) << 13) | ((6 - rankOf(pawn)) << 15);
+    }
+
+    struct KPKPosition
+    {
+        bool whiteToMove;
+        int kings[2];           // white, black
+        int pawn;
+        uint8_t result;
+
+        explicit KPKPosition(int index)
+        {
+            kings[0] = index & 0x3f;
+            kings[1] = (index >> 6) & 0x3f;
+            whiteToMove = ((index >> 12) & 1) == 0;
+            pawn = ((6 - ((index >> 15) & 7)) << 3) + ((index >> 13) & 3);
+
+            const int push = pawn + 8;
+            if (distance(kings[0], kings[1]) <= 1 || kings[0] == pawn || kings[1] == pawn ||
+                (whiteToMove && (pawnAttacks(pawn) & (1ULL << kings[1])))) {
+                result = KPKInvalid;
+            }
+            // the pawn queens without being taken
+            else if (whiteToMove && rankOf(pawn) == 6 && kings[0] != push && kings[1] != push &&
+                     (distance(kings[1], push) > 1 || distance(kings[0], push) == 1)) {
+                result = KPKWin;
+            }
+            // stalemate, or the black king takes an undefended pawn
+            else if (!whiteToMove &&
+                     (!(kingAttacks(kings[1]) & ~(kingAttacks(kings[0]) | pawnAttacks(pawn))) ||
+                      (kingAttacks(kings[1]) & ~kingAttacks(kings[0]) & (1ULL << pawn)))) {
+                result = KPKDraw;
+            }
+            else {
+                result = KPKUnknown;
+            }
+        }
+
+        uint8_t classify(const std::vector<KPKPosition>& db) const
+        {
+            const uint8_t good = whiteToMove ? KPKWin : KPKDraw;
+            const uint8_t bad = whiteToMove ? KPKDraw : KPKWin;
+
+            uint8_t reached = KPKInvalid;
+            const int mover = whiteToMove ? 0 : 1;
+            for (int to : BitBoard(kingAttacks(kings[mover]))) {
+                reached |= whiteToMove ? db[kpkIndex(false, kings[1], to, pawn)].result
+                                       : db[kpkIndex(true, to, kings[0], pawn)].result;
+            }
+            if (whiteToMove) {
+                // a push to the seventh is in the table, a push to the eighth was decided above
+                if (rankOf(pawn) < 6) reached |= db[kpkIndex(false, kings[1], kings[0], pawn + 8)].result;
+                if (rankOf(pawn) == 1 && pawn + 8 != kings[0] && pawn + 8 != kings[1]) {
+                    reached |= db[kpkIndex(false, kings[1], kings[0], pawn + 16)].result;
+                }
+            }
+            return (reached & good) ? good : (reached & KPKUnknown) ? (uint8_t)KPKUnknown : bad;
+        }
+    };
+
+    uint32_t kpkBits[kKPKSize / 32];
+    std::once_flag kpkBuilt;
+
+    void buildKPK()
+    {
+        std::vector<KPKPosition> db;
+        db.reserve(kKPKSize);
+        for (int index = 0; index < kKPKSize; index++) db.emplace_back(index);
+
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (KPKPosition& position : db) {
+                if (position.result == KPKUnknown) {
+                    position.result = position.classify(db);
+                    changed |= position.result != KPKUnknown;
+                }
+            }
+        }
+        // whatever is still unknown can't be forced, so it's a draw
+        for (int index = 0; index < kKPKSize; index++) {
+            if (db[index].result == KPKWin) kpkBits[index >> 5] |= 1u << (index & 31);
+        }
+    }
+}
+
+bool Endgame::kpkIsWin(int strongKing, int strongPawn, int weakKing, bool strongToMove)
+{
+    std::call_once(kpkBuilt, buildKPK);
+    // the table only holds pawns on files a-d
+    if (fileOf(strongPawn) > 3) {
+        strongKing ^= 7;
+        strongPawn ^= 7;
+        weakKing ^= 7;
+    }
+    int index = kpkIndex(strongToMove, weakKing, strongKing, strongPawn);
+    return (kpkBits[index >> 5] >> (index & 31)) & 1;
+}
+
+// 0 in the centre up to 6 in a corner
+static int edgeDistance(int square)
+{
+    int file = fileOf(square), rank = rankOf(square);
+    return std::max(3 - file, file - 4) + std::max(3 - rank, rank - 4);
+}
+
+// lone king against enough material to mate: herd it to the edge and close in
+static int mateScore(int strongKing, int weakKing, int cornerBonus)
+{
+    return kKnownWin + 20 * edgeDistance(weakKing) + 10 * (7 - distance(strongKing, weakKing)) + cornerBonus;
+}
+
+bool Endgame::evaluate(const GameState& position, int& score)
+{
+    // piece counts by colour and type, plus where the kings, pawn and bishop are
+    int count[2][7] = {};
+    int king[2] = { -1, -1 };
+    int pawn = -1, bishop = -1;
+    int pieces = 0;
+    for (int square = 0; square < 64; square++) {
+        ChessPiece piece = position.pieceAt(square);
+        if (piece == NoPiece) continue;
+        int side = position.state[square] >= 'a' ? 1 : 0;
+        if (++pieces > 4) return false;
+        count[side][piece]++;
+        if (piece == King) king[side] = square;
+        if (piece == Pawn) pawn = square;
+        if (piece == Bishop) bishop = square;
+    }
+    if (king[0] < 0 || king[1] < 0) return false;
+
+    auto material = [&](int side) {
+        return count[side][Pawn] + count[side][Knight] + count[side][Bishop] + count[side][Rook] + count[side][Queen];
+    };
+    const int whiteMaterial = material(0);
+    const int blackMaterial = material(1);
+
+    // bare kings, or a single minor piece, can't mate
+    auto minorOnly = [&](int side) {
+        return material(side) == count[side][Knight] + count[side][Bishop] && material(side) <= 1;
+    };
+    if (minorOnly(0) && minorOnly(1)) {
+        score = 0;
+        return true;
+    }
+
+    // from here on one side has everything and the other a bare king
+    if (whiteMaterial > 0 && blackMaterial > 0) return false;
+    const int strong = whiteMaterial > 0 ? 0 : 1;
+    const int weak = 1 - strong;
+    const int sign = strong == 0 ? 1 : -1;
+
+    if (count[strong][Queen] + count[strong][Rook] > 0 && count[strong][Pawn] == 0) {
+        score = sign * mateScore(king[strong], king[weak], 0);
+        return true;
+    }
+    if (count[strong][Bishop] == 1 && count[strong][Knight] == 1) {
+        // only the corners the bishop covers can be mated in, a1/h8 for a dark squared bishop
+        bool darkBishop = (fileOf(bishop) + rankOf(bishop)) % 2 == 0;
+        int cornerDistance = darkBishop ? std::min(distance(king[weak], 0), distance(king[weak], 63))
+                                        : std::min(distance(king[weak], 7), distance(king[weak], 56));
+        score = sign * mateScore(king[strong], king[weak], 40 * (7 - cornerDistance));
+        return true;
+    }
+    if (count[strong][Pawn] == 1 && material(strong) == 1) {
+        // look at it from the pawn's side, flipping the board when black has it
+        int flip = strong == 0 ? 0 : 56;
+        bool strongToMove = (position.color == WHITE) == (strong == 0);
+        if (!kpkIsWin(king[strong] ^ flip, pawn ^ flip, king[weak] ^ flip, strongToMove)) {
+            score = 0;
+        } else {
+            score = sign * (kKnownWin + 100 + 10 * rankOf(pawn ^ flip));
+        }
+        return true;
+    }
+    return false;
+}
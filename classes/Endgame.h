@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include "GameState.h"
+
+//
+// endgame knowledge the search can't find in time on its own
+//
+// KPK is answered exactly from a bitbase built by retrograde analysis the
+// first time it's needed: 2 sides to move x 24 pawn squares (files a-d, the
+// rest are mirrored) x 64 x 64 king squares, one bit each, 24KB in all.
+// KQK, KRK and KBNK get mating evaluators that drive the lone king to the
+// edge (to the right corner for KBNK) and bring the strong king in, and
+// endings with no mating material are scored as draws.
+//
+
+namespace Endgame
+{
+    // strong side is the side with the pawn, squares as seen from that side (pawn moving up)
+    bool kpkIsWin(int strongKing, int strongPawn, int weakKing, bool strongToMove);
+
+    // white-relative score for a recognised ending, false for anything else
+    bool evaluate(const GameState& position, int& score);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//
+// direct-mapped cache of static evaluations by zobrist key
+//
+// each slot is two words: the score, and the key xor'd with the score. a
+// reader recomputes the key from the pair, so a slot another thread is half
+// way through writing reads as a miss rather than someone else's score, with
+// no locks and only relaxed atomics. a newer store simply overwrites an older
+// one in the same slot.
+//
+
+class EvalCache
+{
+public:
+    // entries is rounded down to a power of two
+    explicit EvalCache(size_t entries = 1 << 16)
+    {
+        size_t size = 1;
+        while (size * 2 <= entries) size *= 2;
+        _entries = std::vector<Entry>(size);
+        _mask = size - 1;
+    }
+
+    bool probe(uint64_t key, int& score) const
+    {
+        const Entry& entry = _entries[key & _mask];
+        const uint64_t data = entry.data.load(std::memory_order_relaxed);
+        if ((entry.check.load(std::memory_order_relaxed) ^ data) != key) return false;
+        score = (int32_t)(uint32_t)data;
+        return true;
+    }
+
+    void store(uint64_t key, int score)
+    {
+        Entry& entry = _entries[key & _mask];
+        const uint64_t data = (uint32_t)score;
+        entry.data.store(data, std::memory_order_relaxed);
+        entry.check.store(key ^ data, std::memory_order_relaxed);
+    }
+
+    void clear()
+    {
+        for (Entry& entry : _entries) {
+            entry.check.store(0, std::memory_order_relaxed);
+            entry.data.store(0, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    struct Entry
+    {
+        std::atomic<uint64_t> check{ 0 };
+        std::atomic<uint64_t> data{ 0 };
+    };
+    std::vector<Entry> _entries;
+    size_t _mask = 0;
+};
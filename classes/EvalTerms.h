@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include "Bitboard.h"
+#include "GameState.h"
+
+//
+// what the evaluation's piece terms count, before any weights are applied
+//
+// ChessAI multiplies these by the weights in EvalWeights.h and the tuner
+// works out the weights from them, so the two can't drift apart. each is
+// white's count minus black's.
+//
+
+namespace EvalTerms
+{
+    // squares the knights, bishops, rooks and queens reach that their own side doesn't hold
+    inline int mobility(GameState& position)
+    {
+        const AttackMap& map = position.attacks();
+        auto reach = [&](int side) {
+            const uint64_t own = position._bitboards[side == 0 ? WHITE_ALL_PIECES : BLACK_ALL_PIECES].getData();
+            return popCount((map.byPiece[side][Knight] | map.byPiece[side][Bishop] |
+                             map.byPiece[side][Rook] | map.byPiece[side][Queen]) & ~own);
+        };
+        return reach(0) - reach(1);
+    }
+
+    // squares next to each king that the other side attacks
+    inline int kingZoneAttacks(GameState& position)
+    {
+        const AttackMap& map = position.attacks();
+        return popCount(map.byPiece[0][King] & map.bySide[1]) - popCount(map.byPiece[1][King] & map.bySide[0]);
+    }
+
+    // passed pawns (from the pawn table) with something standing right in front of them
+    inline int blockedPassers(GameState& position, const uint64_t passed[2])
+    {
+        // attacks() brings the bitboards up to date
+        position.attacks();
+        const uint64_t occupied = position._bitboards[OCCUPANCY].getData();
+        return popCount(shiftBoard<North>(passed[0]) & occupied) - popCount(shiftBoard<South>(passed[1]) & occupied);
+    }
+}
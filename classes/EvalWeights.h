@@ -0,0 +1,88 @@
+#pragma once
+
+//
+// evaluation weights, in centipawns
+//
+// tools/tuner fits these to the results of games and writes out a file of the
+// same shape; put it in place of this one to build with the tuned values.
+// penalties are positive and get subtracted.
+//
+
+constexpr int VAL_PAWN   = 100;
+constexpr int VAL_KNIGHT = 320;
+constexpr int VAL_BISHOP = 330;
+constexpr int VAL_ROOK   = 500;
+constexpr int VAL_QUEEN  = 900;
+constexpr int VAL_KING   = 20000;
+
+// per square the knights, bishops, rooks and queens reach that their own side doesn't hold
+constexpr int kMobilityWeight = 2;
+// penalty for each square next to a king the other side attacks
+constexpr int kKingZoneAttack = 6;
+// penalty for a passed pawn with something standing right in front of it
+constexpr int kBlockedPassedPawn = 10;
+
+// bonus for a passed pawn by how far it has come, from its own side
+constexpr int kPassedBonus[8] = { 0, 5, 10, 20, 35, 60, 100, 0 };
+constexpr int kIsolatedPenalty = 15;
+constexpr int kDoubledPenalty = 12;
+constexpr int kBackwardPenalty = 10;
+
+// square bonuses from white's side, written with rank 8 at the top, so a1 is entry 56
+constexpr int kPieceSquareBonus[7][64] = {
+    {},
+    {   // pawn
+          0,   0,   0,   0,   0,   0,   0,   0,
+         50,  50,  50,  50,  50,  50,  50,  50,
+         10,  10,  20,  30,  30,  20,  10,  10,
+          5,   5,  10,  25,  25,  10,   5,   5,
+          0,   0,   0,  20,  20,   0,   0,   0,
+          5,  -5, -10,   0,   0, -10,  -5,   5,
+          5,  10,  10, -20, -20,  10,  10,   5,
+          0,   0,   0,   0,   0,   0,   0,   0 },
+    {   // knight
+        -50, -40, -30, -30, -30, -30, -40, -50,
+        -40, -20,   0,   0,   0,   0, -20, -40,
+        -30,   0,  10,  15,  15,  10,   0, -30,
+        -30,   5,  15,  20,  20,  15,   5, -30,
+        -30,   0,  15,  20,  20,  15,   0, -30,
+        -30,   5,  10,  15,  15,  10,   5, -30,
+        -40, -20,   0,   5,   5,   0, -20, -40,
+        -50, -40, -30, -30, -30, -30, -40, -50 },
+    {   // bishop
+        -20, -10, -10, -10, -10, -10, -10, -20,
+        -10,   0,   0,   0,   0,   0,   0, -10,
+        -10,   0,   5,  10,  10,   5,   0, -10,
+        -10,   5,   5,  10,  10,   5,   5, -10,
+        -10,   0,  10,  10,  10,  10,   0, -10,
+        -10,  10,  10,  10,  10,  10,  10, -10,
+        -10,   5,   0,   0,   0,   0,   5, -10,
+        -20, -10, -10, -10, -10, -10, -10, -20 },
+    {   // rook
+          0,   0,   0,   0,   0,   0,   0,   0,
+          5,  10,  10,  10,  10,  10,  10,   5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+         -5,   0,   0,   0,   0,   0,   0,  -5,
+          0,   0,   0,   5,   5,   0,   0,   0 },
+    {   // queen
+        -20, -10, -10,  -5,  -5, -10, -10, -20,
+        -10,   0,   0,   0,   0,   0,   0, -10,
+        -10,   0,   5,   5,   5,   5,   0, -10,
+         -5,   0,   5,   5,   5,   5,   0,  -5,
+          0,   0,   5,   5,   5,   5,   0,  -5,
+        -10,   5,   5,   5,   5,   5,   0, -10,
+        -10,   0,   5,   0,   0,   0,   0, -10,
+        -20, -10, -10,  -5,  -5, -10, -10, -20 },
+    {   // king, kept behind its pawns while there are pieces about
+        -30, -40, -40, -50, -50, -40, -40, -30,
+        -30, -40, -40, -50, -50, -40, -40, -30,
+        -30, -40, -40, -50, -50, -40, -40, -30,
+        -30, -40, -40, -50, -50, -40, -40, -30,
+        -20, -30, -30, -40, -40, -30, -30, -20,
+        -10, -20, -20, -20, -20, -20, -20, -10,
+         20,  20,   0,   0,   0,   0,  20,  20,
+         20,  30,  10,   0,   0,  10,  30,  20 },
+};
@@ -1,7 +1,6 @@
 #include "Game.h"
 #include "Bit.h"
 #include "BitHolder.h"
-#include "Turn.h"
 #include "../Application.h"
 #include "Chess.h"
 
@@ -21,6 +20,9 @@ Game::Game()
 	_table = nullptr;
 	_winner = nullptr;
 	_lastMove = "";
+	_cachedStateVersion = 0;
+	_pendingMove = kNoHistoryMove;
+	_archive = nullptr;
 	// everything else
 	_dragBit = nullptr;
 	_dragMoved = false;
@@ -33,11 +35,7 @@ Game::Game()
 
 Game::~Game()
 {
-	for (auto &_turn : _turns)
-	{
-		delete _turn;
-	}
-	_turns.clear();
+	archiveGameOver(ArchiveResultUnknown);
 	for (auto &_player : _players)
 	{
 		delete _player;
@@ -66,10 +64,6 @@ void Game::setNumberOfPlayers(unsigned int n)
 
 	_gameOptions.gameNumber = 0;
 	_gameOptions.numberOfPlayers = n;
-
-	Turn *turn = Turn::initStartOfGame(this);
-	_turns.clear();
-	_turns.push_back(turn);
 }
 
 void Game::setAIPlayer(unsigned int playerNumber)
@@ -81,26 +75,45 @@ void Game::setAIPlayer(unsigned int playerNumber)
 
 void Game::startGame()
 {
-	std::string startState = stateString();
-	Turn *turn = _turns.at(0);
-	turn->_boardState = startState;
-	turn->_gameNumber = _gameOptions.gameNumber;
+	_history.reset(stateString());
+	_pendingMove = kNoHistoryMove;
+	if (_archive)
+	{
+		_archive->beginGame();
+	}
 	_gameOptions.currentTurnNo = 0;
 }
 
+const std::string &Game::cachedStateString()
+{
+	if (_cachedStateVersion != BitHolder::boardVersion())
+	{
+		_cachedState = stateString();
+		_cachedStateVersion = BitHolder::boardVersion();
+	}
+	return _cachedState;
+}
+
 void Game::endTurn()
 {
 	_gameOptions.currentTurnNo++;
-	std::string startState = stateString();
-	Turn *turn = new Turn;
-	turn->_boardState = stateString();
-	turn->_date = (int)_gameOptions.currentTurnNo;
-	turn->_score = _gameOptions.score;
-	turn->_gameNumber = _gameOptions.gameNumber;
-	_turns.push_back(turn);
+	_history.record(cachedStateString(), _pendingMove, _gameOptions.score);
+	if (_archive)
+	{
+		_archive->addMove(_pendingMove);
+	}
+	_pendingMove = kNoHistoryMove;
 	ClassGame::EndOfTurn();
 }
 
+void Game::archiveGameOver(ArchiveResult result)
+{
+	if (_archive && _archive->gameInProgress())
+	{
+		_archive->endGame(result);
+	}
+}
+
 //
 // scan for mouse is temporarily in the actual game class
 // this will be moved to a higher up class when the squares have a heirarchy
@@ -120,19 +133,22 @@ void Game::scanForMouse()
 	mousePos.x -= ImGui::GetWindowPos().x;
 	mousePos.y -= ImGui::GetWindowPos().y;
 
+	// the grid maps the mouse straight to the square under it, so this is
+	// constant time no matter how big the board is
 	Entity *entity = nullptr;
-	Grid* grid = getGrid();
-	grid->forEachEnabledSquare([&](ChessSquare* square, int x, int y) {
+	ChessSquare *square = getGrid()->getSquareAtPoint(mousePos);
+	if (square)
+	{
 		Bit *bit = square->bit();
 		if (bit && bit->isMouseOver(mousePos))
 		{
 			entity = bit;
 		}
-		else if (square->isMouseOver(mousePos))
+		else
 		{
 			entity = square;
 		}
-	});
+	}
 	if (ImGui::IsMouseClicked(0))
 	{
 		mouseDown(mousePos, entity);
@@ -149,45 +165,41 @@ void Game::scanForMouse()
 
 void Game::findDropTarget(ImVec2 &pos)
 {
-	Grid* grid = getGrid();
-    grid->forEachEnabledSquare([&](ChessSquare* square, int x, int y) {
-        // Special-case the origin square: if the mouse is over the original holder,
-        // prefer the original holder as the drop target. This ensures dropping
-        // back onto the same square behaves like a cancel/snap-back instead of
-        // accidentally selecting a neighboring square.
-        if (square == _oldHolder)
-        {
-            if (square->isMouseOver(pos))
-            {
-                if (_dropTarget && square != _dropTarget)
-                {
-                    _dropTarget->willNotDropBit(_dragBit);
-                    _dropTarget->setHighlighted(false);
-                }
-                _dropTarget = square;
-                _dropTarget->setHighlighted(true);
-            }
-            // return from the lambda to continue scanning other squares
-            return;
-        }
+    ChessSquare* square = getGrid()->getSquareAtPoint(pos);
+    if (!square)
+    {
+        return;
+    }
 
-        if (square->isMouseOver(pos))
+    // Special-case the origin square: if the mouse is over the original holder,
+    // prefer the original holder as the drop target. This ensures dropping
+    // back onto the same square behaves like a cancel/snap-back instead of
+    // accidentally selecting a neighboring square.
+    if (square == _oldHolder)
+    {
+        if (_dropTarget && square != _dropTarget)
         {
-            if (_dropTarget && square != _dropTarget)
-            {
-                _dropTarget->willNotDropBit(_dragBit);
-                _dropTarget->setHighlighted(false);
-                _dropTarget = nullptr;
-            }
-            // Only mark a non-origin square as a candidate if the holder allows a drop
-            // and the move generator says the move is legal.
-            if (square->canDropBitAtPoint(_dragBit, pos) && canBitMoveFromTo(*_dragBit, *_oldHolder, *square))
-            {
-                _dropTarget = square;
-                _dropTarget->setHighlighted(true);
-            }
+            _dropTarget->willNotDropBit(_dragBit);
+            _dropTarget->setHighlighted(false);
         }
-    });
+        _dropTarget = square;
+        _dropTarget->setHighlighted(true);
+        return;
+    }
+
+    if (_dropTarget && square != _dropTarget)
+    {
+        _dropTarget->willNotDropBit(_dragBit);
+        _dropTarget->setHighlighted(false);
+        _dropTarget = nullptr;
+    }
+    // Only mark a non-origin square as a candidate if the holder allows a drop
+    // and the move generator says the move is legal.
+    if (square->canDropBitAtPoint(_dragBit, pos) && canBitMoveFromTo(*_dragBit, *_oldHolder, *square))
+    {
+        _dropTarget = square;
+        _dropTarget->setHighlighted(true);
+    }
 }
 
 //
@@ -233,6 +245,13 @@ void Game::drawFrame()
 
 void Game::bitMovedFromTo(Bit &bit, BitHolder &src, BitHolder &dst)
 {
+	ChessSquare *from = dynamic_cast<ChessSquare *>(&src);
+	ChessSquare *to = dynamic_cast<ChessSquare *>(&dst);
+	if (from && to)
+	{
+		_pendingMove = makeHistoryMove(getGrid()->getIndex(from->getColumn(), from->getRow()),
+									   getGrid()->getIndex(to->getColumn(), to->getRow()));
+	}
 	endTurn();
 
     Chess* chess = dynamic_cast<Chess*>(this);
@@ -412,6 +431,7 @@ void Game::mouseUp(ImVec2 &location, Entity *entity)
 				_dropTarget->setHighlighted(false);
 			if (_dragBit)
 				_dragBit->setPickedUp(false);
+			clearBoardHighlights();
 			if (_oldHolder)
 				_oldHolder->cancelDragBit(_dragBit);
 			_dragBit->setPosition(_oldPos);
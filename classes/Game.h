@@ -18,7 +18,8 @@
 #endif
 
 #include "Player.h"
-#include "Turn.h"
+#include "GameHistory.h"
+#include "GameArchive.h"
 #include "Bit.h"
 #include "BitHolder.h"
 #include "Grid.h"
@@ -100,6 +101,13 @@ public:
 	virtual std::string initialStateString() = 0;
 	virtual std::string stateString() = 0;
 	virtual void setStateString(const std::string &s) = 0;
+	// stateString() cached against BitHolder::boardVersion(), safe to call every frame
+	const std::string &cachedStateString();
+
+	// optional archive every finished game is appended to; not owned by the game
+	void setArchive(GameArchiveWriter *archive) { _archive = archive; }
+	// close out the archived record for the current game
+	void archiveGameOver(ArchiveResult result);
 
 	void setNumberOfPlayers(unsigned int playerCount);
 	void setAIPlayer(unsigned int playerNumber);
@@ -131,7 +139,8 @@ public:
 	Player *_winner;
 
 	std::vector<Player *> _players;
-	std::vector<Turn *> _turns;
+	// one compact entry per ply, see GameHistory.h
+	GameHistory _history;
 
 	std::string _lastMove;
 
@@ -143,6 +152,13 @@ protected:
 	void mouseUp(ImVec2 &location, Entity *bit);
 	void findDropTarget(ImVec2 &pos);
 
+	std::string _cachedState;
+	uint64_t _cachedStateVersion;
+
+	// move to log for the ply being ended; set before calling endTurn
+	HistoryMove _pendingMove;
+	GameArchiveWriter *_archive;
+
 	ImVec2 _dragStartPos;
 	ImVec2 _dragOffset;
 	ImVec2 _oldPos;
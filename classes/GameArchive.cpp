@@ -0,0 +1,193 @@
+#include "GameArchive.h"
+#include <algorithm>
+#include <cstring>
+
+static inline uint32_t alignTo4(uint32_t size) { return (size + 3) & ~3u; }
+
+//
+// writer
+//
+GameArchiveWriter::GameArchiveWriter() : _file(nullptr), _inGame(false), _gamesWritten(0)
+{
+}
+
+GameArchiveWriter::~GameArchiveWriter()
+{
+    close();
+}
+
+bool GameArchiveWriter::open(const std::string& path)
+{
+    close();
+
+    // refuse to append to something that isn't one of our archives
+    FILE* existing = std::fopen(path.c_str(), "rb");
+    if (existing) {
+        ArchiveFileHeader header;
+        size_t got = std::fread(&header, 1, sizeof(header), existing);
+        std::fclose(existing);
+        if (got != 0 && (got != sizeof(header) || header.magic != kArchiveFileMagic || header.version != kArchiveVersion)) {
+            return false;
+        }
+    }
+
+    _file = std::fopen(path.c_str(), "ab");
+    if (!_file) return false;
+
+    std::fseek(_file, 0, SEEK_END);
+    if (std::ftell(_file) == 0) {
+        ArchiveFileHeader header = {};
+        header.magic = kArchiveFileMagic;
+        header.version = kArchiveVersion;
+        header.headerSize = sizeof(ArchiveFileHeader);
+        std::fwrite(&header, sizeof(header), 1, _file);
+        std::fflush(_file);
+    }
+    return true;
+}
+
+void GameArchiveWriter::close()
+{
+    if (!_file) return;
+    if (_inGame) endGame(ArchiveResultUnknown);
+    std::fclose(_file);
+    _file = nullptr;
+}
+
+void GameArchiveWriter::beginGame(const std::string& startState, const std::string& metadata)
+{
+    if (_inGame) endGame(ArchiveResultUnknown);
+    _startState = startState;
+    _metadata = metadata;
+    _moves.clear();
+    _inGame = true;
+}
+
+void GameArchiveWriter::addMove(HistoryMove move)
+{
+    if (_inGame) _moves.push_back(move);
+}
+
+void GameArchiveWriter::endGame(ArchiveResult result)
+{
+    if (!_inGame) return;
+    _inGame = false;
+    // a game nobody moved in isn't worth keeping
+    if (_moves.empty()) return;
+    writeGame(_moves.data(), (uint32_t)_moves.size(), result, _startState, _metadata);
+}
+
+bool GameArchiveWriter::writeGame(const HistoryMove* moves, uint32_t plyCount, ArchiveResult result,
+                                  const std::string& startState, const std::string& metadata)
+{
+    if (!_file) return false;
+
+    uint16_t startLength = (uint16_t)std::min<size_t>(startState.size(), UINT16_MAX);
+    uint16_t metadataLength = (uint16_t)std::min<size_t>(metadata.size(), UINT16_MAX);
+    uint32_t movesOffset = alignTo4(sizeof(ArchiveGameHeader) + startLength + metadataLength);
+    uint32_t recordSize = alignTo4(movesOffset + plyCount * sizeof(HistoryMove));
+
+    // build the whole record so it lands in the file with a single write
+    _record.assign(recordSize, 0);
+    ArchiveGameHeader header = {};
+    header.magic = kArchiveGameMagic;
+    header.recordSize = recordSize;
+    header.plyCount = plyCount;
+    header.startStateLength = startLength;
+    header.metadataLength = metadataLength;
+    header.result = result;
+    std::memcpy(_record.data(), &header, sizeof(header));
+    std::memcpy(_record.data() + sizeof(header), startState.data(), startLength);
+    std::memcpy(_record.data() + sizeof(header) + startLength, metadata.data(), metadataLength);
+    std::memcpy(_record.data() + movesOffset, moves, plyCount * sizeof(HistoryMove));
+
+    bool ok = std::fwrite(_record.data(), 1, recordSize, _file) == recordSize;
+    std::fflush(_file);
+    if (ok) _gamesWritten++;
+    return ok;
+}
+
+//
+// reader
+//
+GameArchiveReader::GameArchiveReader() : _data(nullptr), _size(0), _offsetsBuilt(false)
+{
+}
+
+GameArchiveReader::~GameArchiveReader()
+{
+    close();
+}
+
+bool GameArchiveReader::open(const std::string& path)
+{
+    close();
+    // games are read front to back far more often than at random
+    if (!_file.open(path, true)) return false;
+    _data = _file.data();
+    _size = _file.size();
+
+    const ArchiveFileHeader* header = reinterpret_cast<const ArchiveFileHeader*>(_data);
+    if (_size < sizeof(ArchiveFileHeader) || header->magic != kArchiveFileMagic || header->version != kArchiveVersion) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void GameArchiveReader::close()
+{
+    _file.close();
+    _data = nullptr;
+    _size = 0;
+    _offsets.clear();
+    _offsetsBuilt = false;
+}
+
+bool GameArchiveReader::readGameAt(uint64_t offset, ArchivedGame& out) const
+{
+    if (!_data || offset + sizeof(ArchiveGameHeader) > _size) return false;
+
+    const ArchiveGameHeader* header = reinterpret_cast<const ArchiveGameHeader*>(_data + offset);
+    if (header->magic != kArchiveGameMagic || header->recordSize < sizeof(ArchiveGameHeader) ||
+        offset + header->recordSize > _size) {
+        // a torn write at the end of the file just ends the archive
+        return false;
+    }
+
+    const char* text = reinterpret_cast<const char*>(_data + offset + sizeof(ArchiveGameHeader));
+    uint32_t movesOffset = alignTo4(sizeof(ArchiveGameHeader) + header->startStateLength + header->metadataLength);
+    if (movesOffset + header->plyCount * sizeof(HistoryMove) > header->recordSize) return false;
+
+    out.plyCount = header->plyCount;
+    out.result = (ArchiveResult)header->result;
+    out.startState = std::string_view(text, header->startStateLength);
+    out.metadata = std::string_view(text + header->startStateLength, header->metadataLength);
+    out.moves = reinterpret_cast<const uint16_t*>(_data + offset + movesOffset);
+    return true;
+}
+
+void GameArchiveReader::buildOffsets()
+{
+    _offsets.clear();
+    uint64_t offset = sizeof(ArchiveFileHeader);
+    ArchivedGame game;
+    while (readGameAt(offset, game)) {
+        _offsets.push_back(offset);
+        offset += reinterpret_cast<const ArchiveGameHeader*>(_data + offset)->recordSize;
+    }
+    _offsetsBuilt = true;
+}
+
+size_t GameArchiveReader::gameCount()
+{
+    if (!_offsetsBuilt) buildOffsets();
+    return _offsets.size();
+}
+
+bool GameArchiveReader::game(size_t id, ArchivedGame& out)
+{
+    if (!_offsetsBuilt) buildOffsets();
+    if (id >= _offsets.size()) return false;
+    return readGameAt(_offsets[id], out);
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "GameHistory.h"
+#include "MappedFile.h"
+
+//
+// binary game archive
+//
+// file layout (little endian, everything 4 byte aligned):
+//
+//   ArchiveFileHeader
+//   ArchiveGameHeader, start state bytes, metadata bytes, padding, uint16 moves[plyCount], padding
+//   ArchiveGameHeader, ...
+//
+// records are only ever appended, and each one carries its own size so a reader
+// can hop from game to game without looking at the moves. the start state is the
+// game's state string (empty means the game's normal starting position) and the
+// metadata is free-form "key=value" lines.
+//
+
+constexpr uint32_t kArchiveFileMagic = 0x52414743;   // "CGAR"
+constexpr uint32_t kArchiveGameMagic = 0x454d4147;   // "GAME"
+constexpr uint16_t kArchiveVersion = 1;
+
+enum ArchiveResult : uint8_t
+{
+    ArchiveResultUnknown = 0,
+    ArchiveResultFirstPlayerWins = 1,     // white in chess
+    ArchiveResultSecondPlayerWins = 2,    // black in chess
+    ArchiveResultDraw = 3
+};
+
+#pragma pack(push, 1)
+struct ArchiveFileHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    uint32_t reserved[2];
+};
+
+struct ArchiveGameHeader
+{
+    uint32_t magic;
+    uint32_t recordSize;        // bytes from this header to the next one
+    uint32_t plyCount;
+    uint16_t startStateLength;
+    uint16_t metadataLength;
+    uint8_t result;
+    uint8_t reserved[3];
+};
+#pragma pack(pop)
+
+//
+// appends finished games to an archive file
+//
+class GameArchiveWriter
+{
+public:
+    GameArchiveWriter();
+    ~GameArchiveWriter();
+
+    // open (or create) an archive for appending
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return _file != nullptr; }
+
+    // start collecting a game; an unfinished game in progress is written out first
+    void beginGame(const std::string& startState = std::string(), const std::string& metadata = std::string());
+    void addMove(HistoryMove move);
+    // write the collected game as one record
+    void endGame(ArchiveResult result);
+    bool gameInProgress() const { return _inGame; }
+
+    uint64_t gamesWritten() const { return _gamesWritten; }
+
+    // write a complete game in one call, used by tools converting other formats
+    bool writeGame(const HistoryMove* moves, uint32_t plyCount, ArchiveResult result,
+                   const std::string& startState = std::string(), const std::string& metadata = std::string());
+
+private:
+    FILE* _file;
+    bool _inGame;
+    std::string _startState;
+    std::string _metadata;
+    std::vector<HistoryMove> _moves;
+    std::vector<uint8_t> _record;
+    uint64_t _gamesWritten;
+};
+
+//
+// one game inside a mapped archive; everything points straight into the mapping
+//
+struct ArchivedGame
+{
+    uint32_t plyCount = 0;
+    ArchiveResult result = ArchiveResultUnknown;
+    const uint16_t* moves = nullptr;
+    std::string_view startState;
+    std::string_view metadata;
+
+    HistoryMove move(uint32_t ply) const { return moves[ply]; }
+};
+
+//
+// read-only view of an archive through a memory mapping
+//
+class GameArchiveReader
+{
+public:
+    GameArchiveReader();
+    ~GameArchiveReader();
+
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return _data != nullptr; }
+
+    // number of games; the offset table is built by hopping headers on first use
+    size_t gameCount();
+    // random access by game id (0 based, in archive order)
+    bool game(size_t id, ArchivedGame& out);
+
+    // walk every game in order without building the offset table;
+    // the callback returns false to stop early
+    template <typename Func>
+    void forEachGame(Func func) const
+    {
+        uint64_t offset = sizeof(ArchiveFileHeader);
+        uint64_t id = 0;
+        ArchivedGame game;
+        while (readGameAt(offset, game)) {
+            if (!func(id, game)) break;
+            offset += reinterpret_cast<const ArchiveGameHeader*>(_data + offset)->recordSize;
+            id++;
+        }
+    }
+
+private:
+    bool readGameAt(uint64_t offset, ArchivedGame& out) const;
+    void buildOffsets();
+
+    MappedFile _file;
+    const uint8_t* _data;
+    uint64_t _size;
+    std::vector<uint64_t> _offsets;
+    bool _offsetsBuilt;
+};
@@ -0,0 +1,113 @@
+#include "GameHistory.h"
+
+GameHistory::GameHistory() : _cursor(0)
+{
+}
+
+void GameHistory::reset(const std::string& startState)
+{
+    _plies.clear();
+    _changes.clear();
+    _keyframes.clear();
+    _keyframes.push_back(startState);
+    _current = startState;
+    _tip = startState;
+    _cursor = 0;
+}
+
+void GameHistory::truncateToCursor()
+{
+    if (_cursor == size()) return;
+
+    _plies.resize(_cursor);
+    _changes.resize(_plies.empty() ? 0 : _plies.back().firstChange + _plies.back().changeCount);
+    _keyframes.resize(_cursor / kKeyframeInterval + 1);
+    _tip = _current;
+}
+
+void GameHistory::record(const std::string& state, HistoryMove move, int score)
+{
+    truncateToCursor();
+
+    // state strings are fixed length for a game; pad rather than lose squares
+    if (_tip.size() < state.size()) {
+        _tip.resize(state.size(), '0');
+    }
+
+    Ply ply;
+    ply.move = move;
+    ply.score = score;
+    ply.firstChange = (uint32_t)_changes.size();
+    for (size_t i = 0; i < state.size(); i++) {
+        if (_tip[i] != state[i]) {
+            _changes.push_back({ (uint16_t)i, _tip[i], state[i] });
+            _tip[i] = state[i];
+        }
+    }
+    ply.changeCount = (uint16_t)(_changes.size() - ply.firstChange);
+    _plies.push_back(ply);
+
+    if (size() % kKeyframeInterval == 0) {
+        _keyframes.push_back(state);
+    }
+    _current = _tip;
+    _cursor = size();
+}
+
+void GameHistory::applyForward(std::string& state, int ply) const
+{
+    const Ply& p = _plies[ply - 1];
+    for (uint32_t i = p.firstChange; i < p.firstChange + p.changeCount; i++) {
+        state[_changes[i].index] = _changes[i].after;
+    }
+}
+
+void GameHistory::applyBackward(std::string& state, int ply) const
+{
+    const Ply& p = _plies[ply - 1];
+    for (uint32_t i = p.firstChange; i < p.firstChange + p.changeCount; i++) {
+        state[_changes[i].index] = _changes[i].before;
+    }
+}
+
+bool GameHistory::undo()
+{
+    if (!canUndo()) return false;
+    applyBackward(_current, _cursor);
+    _cursor--;
+    return true;
+}
+
+bool GameHistory::redo()
+{
+    if (!canRedo()) return false;
+    _cursor++;
+    applyForward(_current, _cursor);
+    return true;
+}
+
+std::string GameHistory::stateAt(int ply) const
+{
+    if (ply < 0 || ply > size()) return std::string();
+
+    int keyframe = ply / kKeyframeInterval;
+    std::string state = _keyframes[keyframe];
+    if (state.size() < _tip.size()) {
+        state.resize(_tip.size(), '0');
+    }
+    for (int p = keyframe * kKeyframeInterval + 1; p <= ply; p++) {
+        applyForward(state, p);
+    }
+    return state;
+}
+
+size_t GameHistory::memoryUsage() const
+{
+    size_t bytes = sizeof(*this);
+    bytes += _plies.capacity() * sizeof(Ply);
+    bytes += _changes.capacity() * sizeof(SquareChange);
+    for (const std::string& keyframe : _keyframes) {
+        bytes += sizeof(std::string) + keyframe.capacity();
+    }
+    return bytes;
+}
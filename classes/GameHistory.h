@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//
+// compact per-game move history
+//
+// every ply stores a 16-bit move plus the squares it changed (old and new
+// state character), so undo/redo only touch the squares that moved.
+// a full state string keyframe is kept every kKeyframeInterval plies, which
+// bounds the work needed to rebuild any ply from scratch.
+//
+
+// 16-bit move: 6 bits from square, 6 bits to square, 4 bits of game defined flags
+// (chess logs a whole BitMove, the flags holding its type and promotion piece)
+typedef uint16_t HistoryMove;
+
+constexpr HistoryMove kNoHistoryMove = 0;
+
+inline HistoryMove makeHistoryMove(int from, int to, int flags = 0)
+{
+    return (HistoryMove)((from & 0x3f) | ((to & 0x3f) << 6) | ((flags & 0xf) << 12));
+}
+inline int historyMoveFrom(HistoryMove move) { return move & 0x3f; }
+inline int historyMoveTo(HistoryMove move) { return (move >> 6) & 0x3f; }
+inline int historyMoveFlags(HistoryMove move) { return (move >> 12) & 0xf; }
+
+class GameHistory
+{
+public:
+    static constexpr int kKeyframeInterval = 32;
+
+    GameHistory();
+
+    // start a new game from the given state
+    void reset(const std::string& startState);
+
+    // record the state reached after a ply; any redo entries are discarded
+    void record(const std::string& state, HistoryMove move, int score);
+
+    // number of plies recorded, and the ply the cursor is on (0 = start position)
+    int size() const { return (int)_plies.size(); }
+    int cursor() const { return _cursor; }
+
+    // step the cursor, returning false if there is nothing to undo/redo
+    bool undo();
+    bool redo();
+    bool canUndo() const { return _cursor > 0; }
+    bool canRedo() const { return _cursor < size(); }
+
+    // state at the cursor
+    const std::string& currentState() const { return _current; }
+    // rebuild the state at any ply (0..size()) from its nearest keyframe
+    std::string stateAt(int ply) const;
+
+    // move and score that produced a ply (1..size())
+    HistoryMove moveAt(int ply) const { return _plies[ply - 1].move; }
+    int scoreAt(int ply) const { return _plies[ply - 1].score; }
+
+    // rough memory footprint in bytes, handy for comparing against full snapshots
+    size_t memoryUsage() const;
+
+private:
+    struct SquareChange
+    {
+        uint16_t index;
+        char before;
+        char after;
+    };
+
+    struct Ply
+    {
+        HistoryMove move;
+        int score;
+        uint32_t firstChange;   // offset into _changes
+        uint16_t changeCount;
+    };
+
+    void truncateToCursor();
+    void applyForward(std::string& state, int ply) const;
+    void applyBackward(std::string& state, int ply) const;
+
+    std::vector<Ply> _plies;
+    std::vector<SquareChange> _changes;
+    // keyframe k holds the state at ply k * kKeyframeInterval
+    std::vector<std::string> _keyframes;
+    // state at the cursor, and at the newest recorded ply
+    std::string _current;
+    std::string _tip;
+    int _cursor;
+};
@@ -1,5 +1,6 @@
 
 #include <algorithm>
+#include <cstdlib>
 #include <iostream>
 #include "GameState.h"
 #include "MagicBitboards.h"
@@ -11,10 +12,20 @@ static BitBoard _pawnAttacks[2][64]; // Precomputed pawn attacks for each square
 void GameState::init(const char* newState, char player) {
     std::memcpy(state, newState, 64);
     color = player;
-    flags = 0;
-    _zobristHash[0] = 0;
-    _zobristHash[1] = 0;
-    _attackBitBoard.setData(0);
+    castlingRights = 0;
+    if (state[4] == 'K') {
+        if (state[7] == 'R') castlingRights |= WhiteKingSide;
+        if (state[0] == 'R') castlingRights |= WhiteQueenSide;
+    }
+    if (state[60] == 'k') {
+        if (state[63] == 'r') castlingRights |= BlackKingSide;
+        if (state[56] == 'r') castlingRights |= BlackQueenSide;
+    }
+    enPassantSquare = -1;
+    halfmoveClock = 0;
+    hash = computeHash();
+    _undoStack.clear();
+    _attackMapValid = false;
     // Clear all bitboards
     for (int i = 0; i < e_numBitboards; ++i) {
         _bitboards[i].setData(0);
@@ -40,8 +51,9 @@ void GameState::init(const char* newState, char player) {
         _bitboardLookup['0'] = EMPTY_SQUARES;
 
         for(int square = 0; square < 64; square++) {
-            _pawnAttacks[0][square].setData(generatePawnAttacksBitBoard(square, WHITE));
-            _pawnAttacks[1][square].setData(generatePawnAttacksBitBoard(square, BLACK));
+            const uint64_t mask = squareMask(square);
+            _pawnAttacks[0][square] = shiftBoard<NorthWest>(mask) | shiftBoard<NorthEast>(mask);
+            _pawnAttacks[1][square] = shiftBoard<SouthWest>(mask) | shiftBoard<SouthEast>(mask);
         }
 
         _initedMagic = true;
@@ -50,300 +62,305 @@ void GameState::init(const char* newState, char player) {
     }
 }
 
-void GameState::shutdown() {
-    cleanupMagicBitboards();
-}
-
-void GameState::addPawnBitboardMovesToList(std::vector<BitMove>& moves, const BitBoard bitboard, const int shift) {
-    if (bitboard.getData() == 0)
-        return;
-    bitboard.forEachBit([&](int toSquare) {
-        int fromSquare = toSquare - shift; // Correct calculation for fromSquare
-        moves.emplace_back(fromSquare, toSquare, Pawn);
-    });
-}
-
-void GameState::generatePawnMoveList(std::vector<BitMove>& moves, const BitBoard pawns, const BitBoard emptySquares, const BitBoard enemyPieces, char color) {
-    if (pawns.getData() == 0)
-        return;
-
-    BitBoard demoRight(NotAFile);
-    BitBoard demoLeft(NotHFile);
-
-    // Calculate single pawn moves forward
-    BitBoard singleMoves = (color == WHITE) ? (pawns.getData() << 8) & emptySquares.getData() : (pawns.getData() >> 8) & emptySquares.getData();
-    // Calculate double pawn moves from starting rank
-    BitBoard doubleMoves = (color == WHITE) ? ((singleMoves.getData() & Rank3) << 8) & emptySquares.getData() : ((singleMoves.getData() & Rank6) >> 8) & emptySquares.getData();
-    // Calculate left and right pawn captures
-    BitBoard capturesLeft = (color == WHITE) ? ((pawns.getData() & NotAFile) << 7) & enemyPieces.getData() : ((pawns.getData() & NotAFile) >> 9) & enemyPieces.getData();
-    BitBoard capturesRight = (color == WHITE) ? ((pawns.getData() & NotHFile) << 9) & enemyPieces.getData() : ((pawns.getData() & NotHFile) >> 7) & enemyPieces.getData();
-
-    int shiftForward = (color == WHITE) ? 8 : -8;
-    int doubleShift = (color == WHITE) ? 16 : -16;
-    int captureLeftShift = (color == WHITE) ? 7 : -9;
-    int captureRightShift = (color == WHITE) ? 9 : -7;
-    
-    // Add single pawn moves to the list
-    addPawnBitboardMovesToList(moves, singleMoves, shiftForward);
-
-    // Add double pawn moves to the list
-    addPawnBitboardMovesToList(moves, doubleMoves, doubleShift);
+bool GameState::initFromFEN(std::string_view fen) {
+    char board[64];
+    std::memset(board, '0', sizeof(board));
+
+    size_t i = 0;
+    int rank = 7, file = 0;
+    for (; i < fen.size() && fen[i] != ' '; i++) {
+        char c = fen[i];
+        if (c == '/') {
+            if (file != 8 || rank == 0) return false;
+            rank--;
+            file = 0;
+        } else if (c >= '1' && c <= '8') {
+            file += c - '0';
+        } else if (std::string_view("PNBRQKpnbrqk").find(c) != std::string_view::npos) {
+            if (file > 7) return false;
+            board[rank * 8 + file++] = c;
+        } else {
+            return false;
+        }
+        if (file > 8) return false;
+    }
+    if (rank != 0 || file != 8) return false;
+
+    while (i < fen.size() && fen[i] == ' ') i++;
+    char player = (i < fen.size() && fen[i] == 'b') ? BLACK : WHITE;
+    init(board, player);
+
+    auto nextField = [&]() {
+        while (i < fen.size() && fen[i] != ' ') i++;
+        while (i < fen.size() && fen[i] == ' ') i++;
+    };
+
+    // castling: init granted every right the pieces allow, keep the ones the FEN names
+    nextField();
+    int rights = 0;
+    for (; i < fen.size() && fen[i] != ' '; i++) {
+        switch (fen[i]) {
+            case 'K': rights |= WhiteKingSide; break;
+            case 'Q': rights |= WhiteQueenSide; break;
+            case 'k': rights |= BlackKingSide; break;
+            case 'q': rights |= BlackQueenSide; break;
+            default: break;
+        }
+    }
+    castlingRights &= rights;
+
+    // en passant, kept only when a pawn can actually take, the same as pushMove
+    nextField();
+    if (i + 1 < fen.size() && fen[i] >= 'a' && fen[i] <= 'h' && (fen[i + 1] == '3' || fen[i + 1] == '6')) {
+        const int square = (fen[i + 1] - '1') * 8 + (fen[i] - 'a');
+        const int pawnSquare = color == WHITE ? square - 8 : square + 8;
+        const char ownPawn = color == WHITE ? 'P' : 'p';
+        const int file = square & 7;
+        if ((file > 0 && state[pawnSquare - 1] == ownPawn) || (file < 7 && state[pawnSquare + 1] == ownPawn)) {
+            enPassantSquare = square;
+        }
+    }
+    hash = computeHash();
 
-    // Add pawn captures to the list
-    addPawnBitboardMovesToList(moves, capturesLeft, captureLeftShift);
-    addPawnBitboardMovesToList(moves, capturesRight, captureRightShift);
+    nextField();
+    int clock = 0;
+    while (i < fen.size() && fen[i] >= '0' && fen[i] <= '9') clock = clock * 10 + (fen[i++] - '0');
+    halfmoveClock = (uint16_t)std::min(clock, 0xffff);
+    return true;
 }
 
-// Generate actual move objects from a bitboard
-void GameState::generateKnightMoves(std::vector<BitMove>& moves, BitBoard knightBoard, uint64_t occupancy) {
-    knightBoard.forEachBit([&](int fromSquare) {
-        BitBoard moveBitboard = BitBoard(KnightAttacks[fromSquare] & occupancy);
-        // Efficiently iterate through only the set bits
-        moveBitboard.forEachBit([&](int toSquare) {
-           moves.emplace_back(fromSquare, toSquare, Knight);
-        });
-    });
+BitMove GameState::moveFor(int from, int to, ChessPiece promotion) const {
+    const ChessPiece piece = pieceAt(from);
+    MoveType type = NormalMove;
+    if (piece == King && std::abs(to - from) == 2) {
+        type = CastlingMove;
+    } else if (piece == Pawn && to == enPassantSquare) {
+        type = EnPassantMove;
+    } else if (piece == Pawn && (to < 8 || to >= 56)) {
+        return BitMove(from, to, PromotionMove, promotion);
+    }
+    return BitMove(from, to, type);
 }
 
-// Generate actual move objects from a bitboard
-void GameState::generateKingMoves(std::vector<BitMove>& moves, BitBoard piecesBoard, uint64_t occupancy) {
-    piecesBoard.forEachBit([&](int fromSquare) {
-        BitBoard moveBitboard = BitBoard(KingAttacks[fromSquare] & occupancy);
-        // Efficiently iterate through only the set bits
-        moveBitboard.forEachBit([&](int toSquare) {
-           moves.emplace_back(fromSquare, toSquare, King);
-        });
-    });
+uint64_t GameState::computeHash() const {
+    uint64_t key = 0;
+    for (int square = 0; square < 64; square++) {
+        key ^= Zobrist::piece(state[square], square);
+    }
+    key ^= Zobrist::castling(castlingRights);
+    if (enPassantSquare >= 0) {
+        key ^= Zobrist::enPassant(enPassantSquare & 7);
+    }
+    if (color == WHITE) {
+        key ^= Zobrist::whiteToMove();
+    }
+    return key;
 }
 
-// Generate actual move objects from a bitboard
-void GameState::generateBishopMoves(std::vector<BitMove>& moves, BitBoard piecesBoard, uint64_t occupancy, uint64_t friendlies)
-{
-    piecesBoard.forEachBit([&](int fromSquare) {
-        BitBoard moveBitboard = BitBoard(getBishopAttacks(fromSquare, occupancy) & ~friendlies);
-        // Efficiently iterate through only the set bits
-        moveBitboard.forEachBit([&](int toSquare) {
-           moves.emplace_back(fromSquare, toSquare, Bishop);
-        });
-    });
+void GameState::shutdown() {
+    cleanupMagicBitboards();
 }
 
-void GameState::generateRooksMoves(std::vector<BitMove>& moves, BitBoard piecesBoard, uint64_t occupancy, uint64_t friendlies)
-{
-    piecesBoard.forEachBit([&](int fromSquare) {
-        BitBoard moveBitboard = BitBoard(getRookAttacks(fromSquare, occupancy) & ~friendlies);
-        // Efficiently iterate through only the set bits
-        moveBitboard.forEachBit([&](int toSquare) {
-           moves.emplace_back(fromSquare, toSquare, Rook);
-        });
+// every square a set of pieces of one type attacks, pawns aside
+template <ChessPiece PIECE_TYPE>
+static uint64_t generatePieceAttackList(uint64_t pieces, uint64_t occupancy) {
+    uint64_t attacks = 0;
+    BitBoard(pieces).forEachBit([&](int fromSquare) {
+        if constexpr (PIECE_TYPE == Knight) attacks |= KnightAttacks[fromSquare];
+        else if constexpr (PIECE_TYPE == Bishop) attacks |= getBishopAttacks(fromSquare, occupancy);
+        else if constexpr (PIECE_TYPE == Rook) attacks |= getRookAttacks(fromSquare, occupancy);
+        else if constexpr (PIECE_TYPE == Queen) attacks |= getQueenAttacks(fromSquare, occupancy);
+        else attacks |= KingAttacks[fromSquare];
     });
+    return attacks;
 }
 
-void GameState::generateQueensMoves(std::vector<BitMove>& moves, BitBoard piecesBoard, uint64_t occupancy, uint64_t friendlies)
-{
-    piecesBoard.forEachBit([&](int fromSquare) {
-        BitBoard moveBitboard = BitBoard(getQueenAttacks(fromSquare, occupancy) & ~friendlies);
-        // Efficiently iterate through only the set bits
-        moveBitboard.forEachBit([&](int toSquare) {
-           moves.emplace_back(fromSquare, toSquare, Queen);
-        });
-    });
+template <GenType Type>
+static void addPromotions(std::vector<BitMove>& moves, int from, int to, bool capture) {
+    // queen first, so anything that takes the first match for a pair of squares gets one
+    if (Type != GenQuiets) moves.emplace_back(from, to, PromotionMove, Queen);
+    if (Type != GenCaptures || capture) {
+        moves.emplace_back(from, to, PromotionMove, Knight);
+        moves.emplace_back(from, to, PromotionMove, Rook);
+        moves.emplace_back(from, to, PromotionMove, Bishop);
+    }
 }
 
-template <ChessPiece PIECE_TYPE>
-inline BitBoard generatePieceAttackList(
-    const BitBoard pieces, 
-    const BitBoard occupancy
-) {
-    BitBoard attacks;
-
-    pieces.forEachBit([&](int fromSquare) {
-        // We'll branch on the piece type. 
-        // This uses if constexpr for compile-time resolution
-        if (PIECE_TYPE == Knight) {
-            // Combine all knight moves from `fromSquare`
-            attacks |= KnightAttacks[fromSquare];
-        }
-        else if (PIECE_TYPE == Bishop) {
-            attacks |= BitBoard(getBishopAttacks(fromSquare, occupancy.getData())); 
-        }
-        else if (PIECE_TYPE == Rook) {
-            attacks |= BitBoard(getRookAttacks(fromSquare, occupancy.getData())); 
-        }
-        else if (PIECE_TYPE == Queen) {
-            // Queen is rook + bishop combined
-            attacks |= (BitBoard(getBishopAttacks(fromSquare, occupancy.getData())) |
-                        BitBoard(getRookAttacks(fromSquare, occupancy.getData())));
-        }
-        else if (PIECE_TYPE == King) {
-            attacks |= KingAttacks[fromSquare];
-        }
-        else {
-            // Optionally handle or static_assert for unexpected piece types
-        }
-    });
-
-    return attacks;
-}
+template <int Color, GenType Type>
+void GameState::generatePawnMoves(std::vector<BitMove>& moves, uint64_t target) {
+    constexpr Direction Up = Color == WHITE ? North : South;
+    constexpr Direction UpLeft = Color == WHITE ? NorthWest : SouthWest;     // towards the a-file
+    constexpr Direction UpRight = Color == WHITE ? NorthEast : SouthEast;    // towards the h-file
+    constexpr uint64_t DoublePushRank = Color == WHITE ? Rank3 : Rank6;
+    constexpr uint64_t LastRank = Color == WHITE ? Rank8 : Rank1;
+    constexpr int Us = Color == WHITE ? WHITE_PAWNS : BLACK_PAWNS;
+    constexpr int Them = Color == WHITE ? BLACK_PAWNS : WHITE_PAWNS;
+
+    const uint64_t pawns = _bitboards[Us + WHITE_PAWNS].getData();
+    if (pawns == 0)
+        return;
+    const uint64_t empty = ~_bitboards[OCCUPANCY].getData();
+    const uint64_t enemies = _bitboards[Them + WHITE_ALL_PIECES].getData();
 
-uint64_t GameState::generatePawnAttacksBitBoard(int square, char color) {
-    uint64_t bitboard = 0ULL;
-    int rank = square / 8;
-    int file = square % 8;
+    auto addMoves = [&](uint64_t destinations, int delta) {
+        BitBoard(destinations).forEachBit([&](int to) { moves.emplace_back(to - delta, to); });
+    };
 
-    // Pawns can only attack diagonally forward
-    // For white: up-right and up-left
-    // For black: down-right and down-left
-    const int direction = (color == WHITE) ? 1 : -1;
-    
-    // Check diagonal left attack
-    if (file > 0) {  // Not on a-file
-        int r = rank + direction;
-        int f = file - 1;
-        if (r >= 0 && r < 8) {  // Stay within board bounds
-            bitboard |= 1ULL << (r * 8 + f);
+    if constexpr (Type != GenCaptures) {
+        const uint64_t single = shiftBoard<Up>(pawns) & empty;
+        addMoves(single & target & ~LastRank, Up);
+        addMoves(shiftBoard<Up>(single & DoublePushRank) & empty & target, 2 * Up);
+    }
+    if constexpr (Type != GenQuiets) {
+        addMoves(shiftBoard<UpLeft>(pawns) & enemies & target & ~LastRank, UpLeft);
+        addMoves(shiftBoard<UpRight>(pawns) & enemies & target & ~LastRank, UpRight);
+
+        if (enPassantSquare >= 0) {
+            // the pawns that can take are the squares an enemy pawn on the target would attack;
+            // in check these are left for filterOutIllegalMoves to judge
+            BitBoard takers(_pawnAttacks[Color == WHITE ? 1 : 0][enPassantSquare].getData() & pawns);
+            takers.forEachBit([&](int from) { moves.emplace_back(from, enPassantSquare, EnPassantMove); });
         }
     }
-    
-    // Check diagonal right attack
-    if (file < 7) {  // Not on h-file
-        int r = rank + direction;
-        int f = file + 1;
-        if (r >= 0 && r < 8) {  // Stay within board bounds
-            bitboard |= 1ULL << (r * 8 + f);
+
+    // promotions, pushes and captures alike; an evasion has to land on the target
+    const uint64_t promotionTarget = Type == GenEvasions ? target : ~0ULL;
+    const uint64_t promoting = shiftBoard<Up>(pawns) & LastRank;
+    if (promoting) {
+        BitBoard(promoting & empty & promotionTarget).forEachBit([&](int to) {
+            addPromotions<Type>(moves, to - Up, to, false);
+        });
+        if constexpr (Type != GenQuiets) {
+            BitBoard(shiftBoard<UpLeft>(pawns) & LastRank & enemies & promotionTarget).forEachBit([&](int to) {
+                addPromotions<Type>(moves, to - UpLeft, to, true);
+            });
+            BitBoard(shiftBoard<UpRight>(pawns) & LastRank & enemies & promotionTarget).forEachBit([&](int to) {
+                addPromotions<Type>(moves, to - UpRight, to, true);
+            });
         }
     }
-    return bitboard;
 }
 
-const BitBoard GameState::generatePawnAttacks(const BitBoard pawns, char color) {
-    BitBoard result(0);
-
-    pawns.forEachBit([&](int fromSquare) {
-        // Using precomputed or dynamic logic
-        result |= _pawnAttacks[color == WHITE ? 0 : 1][fromSquare];
+template <ChessPiece Piece>
+void GameState::generatePieceMoves(std::vector<BitMove>& moves, uint64_t pieces, uint64_t target) {
+    const uint64_t occupancy = _bitboards[OCCUPANCY].getData();
+    BitBoard(pieces).forEachBit([&](int from) {
+        uint64_t attacks;
+        if constexpr (Piece == Knight) attacks = KnightAttacks[from];
+        else if constexpr (Piece == Bishop) attacks = getBishopAttacks(from, occupancy);
+        else if constexpr (Piece == Rook) attacks = getRookAttacks(from, occupancy);
+        else if constexpr (Piece == Queen) attacks = getQueenAttacks(from, occupancy);
+        else attacks = KingAttacks[from];
+        BitBoard(attacks & target).forEachBit([&](int to) { moves.emplace_back(from, to); });
     });
-
-    return result;
 }
 
-// Returns true if 'square' is attacked by any piece belonging to 'attackerColor'
-bool GameState::isSquareAttacked(int square, char attackerColor, const BitBoard (&boards)[e_numBitboards]) {
-	const int pawnIdx   = (attackerColor == WHITE) ? WHITE_PAWNS : BLACK_PAWNS;
-	const int knightIdx = (attackerColor == WHITE) ? WHITE_KNIGHTS : BLACK_KNIGHTS;
-	const int bishopIdx = (attackerColor == WHITE) ? WHITE_BISHOPS : BLACK_BISHOPS;
-	const int rookIdx   = (attackerColor == WHITE) ? WHITE_ROOKS : BLACK_ROOKS;
-	const int queenIdx  = (attackerColor == WHITE) ? WHITE_QUEENS : BLACK_QUEENS;
-	const int kingIdx   = (attackerColor == WHITE) ? WHITE_KING : BLACK_KING;
-
-	// Get Occupancy of all pieces for sliding checks
-	BitBoard occ = boards[OCCUPANCY];
-
-	// Check Pawn Attacks
-	char targetColor = (attackerColor == WHITE) ? BLACK : WHITE; 
-	if ((generatePawnAttacksBitBoard(square, targetColor) & boards[pawnIdx].getData()) != 0) return true;
+template <int Color>
+void GameState::generateCastlingMoves(std::vector<BitMove>& moves) {
+    constexpr int home = Color == WHITE ? 4 : 60;
+    constexpr int kingSide = Color == WHITE ? WhiteKingSide : BlackKingSide;
+    constexpr int queenSide = Color == WHITE ? WhiteQueenSide : BlackQueenSide;
+    if ((castlingRights & (kingSide | queenSide)) == 0)
+        return;
 
-	// Check Knight Attacks
-	if ((KnightAttacks[square] & boards[knightIdx].getData()) != 0) return true;
+    // the rights mean king and rook are still home; the king can't castle out of,
+    // through or into check, the rook is free to pass attacked squares
+    const uint64_t occupancy = _bitboards[OCCUPANCY].getData();
+    const uint64_t attacked = _attackMap.bySide[Color == WHITE ? 1 : 0];
+    if (attacked & (1ULL << home))
+        return;
+    if ((castlingRights & kingSide) && (occupancy & (3ULL << (home + 1))) == 0 &&
+        (attacked & (3ULL << (home + 1))) == 0) {
+        moves.emplace_back(home, home + 2, CastlingMove);
+    }
+    if ((castlingRights & queenSide) && (occupancy & (7ULL << (home - 3))) == 0 &&
+        (attacked & (3ULL << (home - 2))) == 0) {
+        moves.emplace_back(home, home - 2, CastlingMove);
+    }
+}
 
-	// Check King Attacks (Neighboring kings)
-	if ((KingAttacks[square] & boards[kingIdx].getData()) != 0) return true;
+template <int Color, GenType Type>
+void GameState::generate(std::vector<BitMove>& moves) {
+    constexpr int Us = Color == WHITE ? WHITE_PAWNS : BLACK_PAWNS;
+    constexpr int Them = Color == WHITE ? BLACK_PAWNS : WHITE_PAWNS;
+    const uint64_t own = _bitboards[Us + WHITE_ALL_PIECES].getData();
+    const uint64_t enemies = _bitboards[Them + WHITE_ALL_PIECES].getData();
+    const uint64_t kings = _bitboards[Us + WHITE_KING].getData();
+
+    uint64_t target;
+    if constexpr (Type == GenCaptures) target = enemies;
+    else if constexpr (Type == GenQuiets) target = ~_bitboards[OCCUPANCY].getData();
+    else target = ~own;
+
+    if constexpr (Type == GenEvasions) {
+        // with two checkers only the king can move; with one, the rest can take it or block
+        const int king = BitBoard(kings).firstBit();
+        const uint64_t checkers = _attackMap.checkers;
+        generatePieceMoves<King>(moves, kings, ~own);
+        if (moreThanOne(checkers))
+            return;
+        const int checker = BitBoard(checkers).firstBit();
+        target = checkers | betweenSquares(king, checker);
+    }
 
-	// Check Bishop/Queen (Diagonal) Attacks
-	uint64_t diagonalAttacks = getBishopAttacks(square, occ.getData());
-	if ((diagonalAttacks & (boards[bishopIdx].getData() | boards[queenIdx].getData())) != 0) return true;
+    generatePawnMoves<Color, Type>(moves, target);
+    generatePieceMoves<Knight>(moves, _bitboards[Us + WHITE_KNIGHTS].getData(), target);
+    generatePieceMoves<Bishop>(moves, _bitboards[Us + WHITE_BISHOPS].getData(), target);
+    generatePieceMoves<Rook>(moves, _bitboards[Us + WHITE_ROOKS].getData(), target);
+    generatePieceMoves<Queen>(moves, _bitboards[Us + WHITE_QUEENS].getData(), target);
+    if constexpr (Type != GenEvasions) {
+        generatePieceMoves<King>(moves, kings, target);
+    }
+    if constexpr (Type == GenQuiets || Type == GenAll) {
+        generateCastlingMoves<Color>(moves);
+    }
+}
 
-	// Check Rook/Queen (Straight) Attacks
-	uint64_t straightAttacks = getRookAttacks(square, occ.getData());
-	if ((straightAttacks & (boards[rookIdx].getData() | boards[queenIdx].getData())) != 0) return true;
+uint64_t GameState::attackersTo(int square, uint64_t occupancy) const {
+    const uint64_t diagonal = _bitboards[WHITE_BISHOPS].getData() | _bitboards[WHITE_QUEENS].getData() |
+                              _bitboards[BLACK_BISHOPS].getData() | _bitboards[BLACK_QUEENS].getData();
+    const uint64_t straight = _bitboards[WHITE_ROOKS].getData() | _bitboards[WHITE_QUEENS].getData() |
+                              _bitboards[BLACK_ROOKS].getData() | _bitboards[BLACK_QUEENS].getData();
+    return (_pawnAttacks[1][square].getData() & _bitboards[WHITE_PAWNS].getData()) |
+           (_pawnAttacks[0][square].getData() & _bitboards[BLACK_PAWNS].getData()) |
+           (KnightAttacks[square] & (_bitboards[WHITE_KNIGHTS].getData() | _bitboards[BLACK_KNIGHTS].getData())) |
+           (KingAttacks[square] & (_bitboards[WHITE_KING].getData() | _bitboards[BLACK_KING].getData())) |
+           (getBishopAttacks(square, occupancy) & diagonal) |
+           (getRookAttacks(square, occupancy) & straight);
+}
 
-	return false;
+// en passant takes two pawns off one rank at once, which the pin test can't see,
+// so look from the king again with the board as the capture would leave it
+bool GameState::enPassantExposesKing(const BitMove& move) const {
+    const int us = color == WHITE ? WHITE_PAWNS : BLACK_PAWNS;
+    const int them = color == WHITE ? BLACK_PAWNS : WHITE_PAWNS;
+    const int king = _bitboards[us + WHITE_KING].firstBit();
+    if (king < 0)
+        return false;
+    const uint64_t captured = 1ULL << (color == WHITE ? move.to() - 8 : move.to() + 8);
+    const uint64_t occupancy = (_bitboards[OCCUPANCY].getData() ^ (1ULL << move.from()) ^ captured) | (1ULL << move.to());
+    return (attackersTo(king, occupancy) & _bitboards[them + WHITE_ALL_PIECES].getData() & ~captured) != 0;
 }
 
 void GameState::filterOutIllegalMoves(std::vector<BitMove>& moves) {
-	if (moves.empty()) return;
+	const int king = _bitboards[color == WHITE ? WHITE_KING : BLACK_KING].firstBit();
+	if (moves.empty() || king < 0) return;
 
-	const char myColor = color;
-	const char opponentColor = (color == WHITE) ? BLACK : WHITE;
-	const int myKingIdx = (myColor == WHITE) ? WHITE_KING : BLACK_KING;
-
-	// Remove moves that leave the king in check
+	// only king moves, pinned pieces and en passant can leave the king in check;
+	// castling had its squares checked when it was generated
 	moves.erase(std::remove_if(moves.begin(), moves.end(), [&](const BitMove& move) {
-		
-		// Create a temporary copy of the board state
-		BitBoard tempBoards[e_numBitboards];
-		for (int i = 0; i < e_numBitboards; ++i) tempBoards[i] = _bitboards[i];
-
-		// Apply the move to the temporary boards
-		// Note: We just need occupancy correct for check detection.
-		
-		const uint64_t fromMask = 1ULL << move.from;
-		const uint64_t toMask   = 1ULL << move.to;
-		
-		// Helper to determine which bitboard a piece belongs to
-		auto getPieceIdx = [&](ChessPiece p, char c) {
-			if (p == Pawn) return c == WHITE ? WHITE_PAWNS : BLACK_PAWNS;
-			if (p == Knight) return c == WHITE ? WHITE_KNIGHTS : BLACK_KNIGHTS;
-			if (p == Bishop) return c == WHITE ? WHITE_BISHOPS : BLACK_BISHOPS;
-			if (p == Rook) return c == WHITE ? WHITE_ROOKS : BLACK_ROOKS;
-			if (p == Queen) return c == WHITE ? WHITE_QUEENS : BLACK_QUEENS;
-			return c == WHITE ? WHITE_KING : BLACK_KING; // King
-		};
-
-		int moverIdx = getPieceIdx(static_cast<ChessPiece>(move.piece), myColor);
-		
-		// Remove from 'from'
-		tempBoards[moverIdx] &= ~fromMask;
-		tempBoards[OCCUPANCY] &= ~fromMask;
-
-		// Handle Captures (Remove opponent piece at 'to')
-		// We scan opponent boards to find what was captured (slower than lookup, but safe for generic bitboards)
-		int startOpp = (opponentColor == WHITE) ? WHITE_PAWNS : BLACK_PAWNS;
-		int endOpp   = (opponentColor == WHITE) ? WHITE_KING : BLACK_KING;
-		
-		// Specialized handling for En Passant
-		if (move.flags & EnPassant) {
-			int capSq = (myColor == WHITE) ? (move.to - 8) : (move.to + 8);
-			uint64_t capMask = 1ULL << capSq;
-			tempBoards[startOpp] &= ~capMask; // Opponent Pawns
-			tempBoards[OCCUPANCY] &= ~capMask;
-		} else {
-			// Standard capture
-			for (int i = startOpp; i <= endOpp; ++i) {
-				tempBoards[i] &= ~toMask;
-			}
-			tempBoards[OCCUPANCY] &= ~toMask; // Clear strictly to ensure no overlap before adding
-		}
-
-		// Handle Promotion
-		if ((move.flags & IsPromotion)) {
-			moverIdx = getPieceIdx(Queen, myColor); // Assume Queen promotion for check safety (mostly covers it)
-		}
-
-		// Add to 'to'
-		tempBoards[moverIdx] |= toMask;
-		tempBoards[OCCUPANCY] |= toMask;
-
-		// Handle King Move (Update King Index tracking)
-		int currentKingSquare = -1;
-		if (move.piece == King) {
-			currentKingSquare = move.to;
-		} else {
-			// If king didn't move, find him
-			currentKingSquare = tempBoards[myKingIdx].firstBit();
-		}
-
-		// If the King is attacked by the opponent after this move, the move is illegal.
-		return isSquareAttacked(currentKingSquare, opponentColor, tempBoards);
-
+		const int from = move.from();
+		if (from == king)
+			return move.type() != CastlingMove && (_attackMap.kingDanger & (1ULL << move.to())) != 0;
+		if (move.type() == EnPassantMove)
+			return enPassantExposesKing(move);
+		// a pinned piece may still slide along the pin
+		return (_attackMap.pinned & (1ULL << from)) != 0 && (lineThrough(king, from) & (1ULL << move.to())) == 0;
 	}), moves.end());
 }
 
-std::vector<BitMove> GameState::generateAllMoves()
+void GameState::buildBitboards()
 {
-    std::vector<BitMove> moves;
-    moves.reserve(32);
-
     for (int i=0; i<e_numBitboards; i++) {
         _bitboards[i] = 0;
     }
@@ -362,16 +379,96 @@ std::vector<BitMove> GameState::generateAllMoves()
     _bitboards[BLACK_QUEENS].getData() | _bitboards[BLACK_KING].getData();
     
     _bitboards[OCCUPANCY] = _bitboards[WHITE_ALL_PIECES].getData() | _bitboards[BLACK_ALL_PIECES].getData();
+}
+
+void GameState::computeAttackMap()
+{
+    buildBitboards();
+    const uint64_t occupancy = _bitboards[OCCUPANCY].getData();
+
+    for (int side = 0; side < 2; side++) {
+        const int base = side == 0 ? WHITE_PAWNS : BLACK_PAWNS;
+        const uint64_t pawns = _bitboards[base + WHITE_PAWNS].getData();
+        uint64_t* attacks = _attackMap.byPiece[side];
+        attacks[NoPiece] = 0;
+        attacks[Pawn] = side == 0 ? shiftBoard<NorthWest>(pawns) | shiftBoard<NorthEast>(pawns)
+                                  : shiftBoard<SouthWest>(pawns) | shiftBoard<SouthEast>(pawns);
+        attacks[Knight] = generatePieceAttackList<Knight>(_bitboards[base + WHITE_KNIGHTS].getData(), occupancy);
+        attacks[Bishop] = generatePieceAttackList<Bishop>(_bitboards[base + WHITE_BISHOPS].getData(), occupancy);
+        attacks[Rook] = generatePieceAttackList<Rook>(_bitboards[base + WHITE_ROOKS].getData(), occupancy);
+        attacks[Queen] = generatePieceAttackList<Queen>(_bitboards[base + WHITE_QUEENS].getData(), occupancy);
+        attacks[King] = generatePieceAttackList<King>(_bitboards[base + WHITE_KING].getData(), occupancy);
+        _attackMap.bySide[side] = attacks[Pawn] | attacks[Knight] | attacks[Bishop] | attacks[Rook] | attacks[Queen] | attacks[King];
+    }
 
-    int bitIndex = color == WHITE ? WHITE_PAWNS : BLACK_PAWNS;
-    int oppBitIndex = color == WHITE ? BLACK_PAWNS : WHITE_PAWNS;
+    const int us = color == WHITE ? WHITE_PAWNS : BLACK_PAWNS;
+    const int them = color == WHITE ? BLACK_PAWNS : WHITE_PAWNS;
+    const uint64_t kingMask = _bitboards[us + WHITE_KING].getData();
+    const int king = BitBoard(kingMask).firstBit();
+    _attackMap.checkers = 0;
+    _attackMap.pinned = 0;
+    _attackMap.kingDanger = _attackMap.bySide[color == WHITE ? 1 : 0];
+    _attackMapKey = hash;
+    _attackMapValid = true;
+    if (king < 0)
+        return;
+
+    const uint64_t diagonal = _bitboards[them + WHITE_BISHOPS].getData() | _bitboards[them + WHITE_QUEENS].getData();
+    const uint64_t straight = _bitboards[them + WHITE_ROOKS].getData() | _bitboards[them + WHITE_QUEENS].getData();
+    _attackMap.checkers = attackersTo(king, occupancy) & _bitboards[them + WHITE_ALL_PIECES].getData();
+
+    // a checking slider also covers the squares behind the king, which stepping back doesn't escape
+    const uint64_t throughKing = occupancy ^ kingMask;
+    _attackMap.kingDanger |= generatePieceAttackList<Bishop>(_attackMap.checkers & diagonal, throughKing) |
+                             generatePieceAttackList<Rook>(_attackMap.checkers & straight, throughKing);
+
+    // a lone piece of ours between the king and an enemy slider lined up on it is pinned
+    const uint64_t own = _bitboards[us + WHITE_ALL_PIECES].getData();
+    const uint64_t snipers = (getBishopAttacks(king, 0) & diagonal) | (getRookAttacks(king, 0) & straight);
+    BitBoard(snipers).forEachBit([&](int sniper) {
+        const uint64_t blockers = betweenSquares(king, sniper) & occupancy;
+        if (blockers && !moreThanOne(blockers) && (blockers & own)) _attackMap.pinned |= blockers;
+    });
+}
 
-    generateKnightMoves(moves, _bitboards[WHITE_KNIGHTS + bitIndex], ~_bitboards[WHITE_ALL_PIECES + bitIndex].getData());
-    generatePawnMoveList(moves, _bitboards[WHITE_PAWNS  + bitIndex], ~_bitboards[OCCUPANCY].getData(), _bitboards[WHITE_ALL_PIECES + oppBitIndex].getData(), color);
-    generateKingMoves(moves, _bitboards[WHITE_KING + bitIndex], ~_bitboards[WHITE_ALL_PIECES + bitIndex].getData());
-    generateBishopMoves(moves, _bitboards[WHITE_BISHOPS + bitIndex], _bitboards[OCCUPANCY].getData(), _bitboards[WHITE_ALL_PIECES + bitIndex].getData());
-    generateRooksMoves(moves, _bitboards[WHITE_ROOKS + bitIndex], _bitboards[OCCUPANCY].getData(), _bitboards[WHITE_ALL_PIECES + bitIndex].getData());
-    generateQueensMoves(moves, _bitboards[WHITE_QUEENS + bitIndex], _bitboards[OCCUPANCY].getData(), _bitboards[WHITE_ALL_PIECES + bitIndex].getData());
+std::vector<BitMove> GameState::generateMoves(GenType type)
+{
+    std::vector<BitMove> moves;
+    moves.reserve(48);
+
+    const AttackMap& map = attacks();
+
+    // when in check only evasions can be legal, so asking for all of them means those
+    if (type == GenAll || type == GenEvasions) {
+        type = map.checkers ? GenEvasions : GenAll;
+    } else if (map.checkers) {
+        // the filter below trusts the generator to have answered the check, so split the
+        // evasions instead: queen promotions and anything landing on a piece are captures
+        const bool captures = type == GenCaptures;
+        moves = generateMoves(GenEvasions);
+        moves.erase(std::remove_if(moves.begin(), moves.end(), [&](const BitMove& move) {
+            const bool capture = state[move.to()] != '0' || move.type() == EnPassantMove ||
+                                 (move.type() == PromotionMove && move.promotion() == Queen);
+            return capture != captures;
+        }), moves.end());
+        return moves;
+    }
+
+    if (color == WHITE) {
+        switch (type) {
+            case GenCaptures: generate<WHITE, GenCaptures>(moves); break;
+            case GenQuiets: generate<WHITE, GenQuiets>(moves); break;
+            case GenEvasions: generate<WHITE, GenEvasions>(moves); break;
+            case GenAll: generate<WHITE, GenAll>(moves); break;
+        }
+    } else {
+        switch (type) {
+            case GenCaptures: generate<BLACK, GenCaptures>(moves); break;
+            case GenQuiets: generate<BLACK, GenQuiets>(moves); break;
+            case GenEvasions: generate<BLACK, GenEvasions>(moves); break;
+            case GenAll: generate<BLACK, GenAll>(moves); break;
+        }
+    }
 
     filterOutIllegalMoves(moves);
 
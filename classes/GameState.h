@@ -4,18 +4,26 @@
 #include <iostream>
 #include <cstring>
 #include <cstdint>
+#include <algorithm>
 #include <vector>
+#include <string_view>
 #include "Bitboard.h"
+#include "Zobrist.h"
 
 constexpr int WHITE = +1;
 constexpr int BLACK = -1;
-// Define a constant for the maximum depth of your AI.
-constexpr int MAX_DEPTH = 24;
-// Define constants for ranks and files
-constexpr uint64_t NotAFile(0xFEFEFEFEFEFEFEFEULL); // A file mask
-constexpr uint64_t NotHFile(0x7F7F7F7F7F7F7F7FULL); // H file mask
-constexpr uint64_t Rank3(0x0000000000FF0000ULL); // Rank 3 mask
-constexpr uint64_t Rank6(0x0000FF0000000000ULL); // Rank 6 mask
+// state string for the standard starting position, a1 = index 0
+constexpr const char* kStartingState =
+    "RNBQKBNR" "PPPPPPPP" "00000000" "00000000" "00000000" "00000000" "pppppppp" "rnbqkbnr";
+
+// which moves generateMoves produces; captures and quiets together make up all
+// of them, with queen promotions counted as captures and underpromotions as quiets
+enum GenType {
+    GenCaptures,
+    GenQuiets,
+    GenEvasions,    // replies to a check: king moves, taking the checker, blocking
+    GenAll
+};
 
 enum AllBitBoards
 {
@@ -38,111 +46,284 @@ enum AllBitBoards
     e_numBitboards
 };
 
-enum MoveFlags {
-    EnPassant = 0x01, // 0000 0001
-    IsCapture = 0x02, // 0000 0010
-    KingSideCastle = 0x04, // 0000 0100
-    QueenSideCastle = 0x08, // 0000 1000
-    IsPromotion = 0x10 // 0001 0000
+// what a move does beyond taking whatever stands on its destination;
+// a castle is king side when it moves right
+enum MoveType {
+    NormalMove = 0,
+    PromotionMove = 1,
+    EnPassantMove = 2,
+    CastlingMove = 3
 };
 
-#pragma pack(push, 1)
+// castling rights, bit i matches Zobrist::castle(i)
+enum CastlingRights {
+    WhiteKingSide = 0x01,
+    WhiteQueenSide = 0x02,
+    BlackKingSide = 0x04,
+    BlackQueenSide = 0x08,
+    AllCastling = 0x0f
+};
+
+// rights lost when a piece leaves or is captured on a square
+constexpr int castlingMask(int square) {
+    switch (square) {
+        case 0: return WhiteQueenSide;
+        case 4: return WhiteKingSide | WhiteQueenSide;
+        case 7: return WhiteKingSide;
+        case 56: return BlackQueenSide;
+        case 60: return BlackKingSide | BlackQueenSide;
+        case 63: return BlackKingSide;
+        default: return 0;
+    }
+}
+
+// state character for a piece type, 'P' for a white pawn, 'p' for a black one
+constexpr char pieceCharacter(ChessPiece piece, int color) {
+    constexpr const char* kWhite = "0PNBRQK";
+    constexpr const char* kBlack = "0pnbrqk";
+    return color == WHITE ? kWhite[piece] : kBlack[piece];
+}
+
+//
+// one move in 16 bits: from (bits 0-5), to (6-11), promotion piece less a
+// knight (12-13) and MoveType (14-15). from and to sit where a HistoryMove
+// keeps them, so a chess game logs its moves as they are. the mover and any
+// capture are read off the board, which every user of a move has at hand.
+//
 struct BitMove {
-    unsigned char from;
-    unsigned char to;
-    unsigned char piece;
-    unsigned char flags;
-
-    BitMove(int from, int to, ChessPiece piece, int flags = 0)
-        : from(from), to(to), piece(piece), flags(flags) { }
-        
-    BitMove() : from(0), to(0), piece(NoPiece), flags(0) { }
-    
-    bool operator==(const BitMove& other) const {
-        return from == other.from && 
-               to == other.to && 
-               piece == other.piece &&
-               flags == other.flags;
+    uint16_t data;
+
+    constexpr BitMove() : data(0) { }
+    constexpr explicit BitMove(uint16_t raw) : data(raw) { }
+    constexpr BitMove(int from, int to, MoveType type = NormalMove, ChessPiece promotion = Knight)
+        : data((uint16_t)(from | (to << 6) | ((promotion - Knight) << 12) | (type << 14))) { }
+
+    constexpr int from() const { return data & 0x3f; }
+    constexpr int to() const { return (data >> 6) & 0x3f; }
+    constexpr MoveType type() const { return static_cast<MoveType>(data >> 14); }
+    // piece a promotion becomes; a pawn move logged with only its squares becomes a queen
+    constexpr ChessPiece promotion() const {
+        return type() == PromotionMove ? static_cast<ChessPiece>(Knight + ((data >> 12) & 3)) : Queen;
     }
+    constexpr bool isNull() const { return data == 0; }
+    constexpr uint16_t raw() const { return data; }
+
+    constexpr bool operator==(const BitMove& other) const { return data == other.data; }
+    constexpr bool operator!=(const BitMove& other) const { return data != other.data; }
 };
-#pragma pack(pop)
+static_assert(sizeof(BitMove) == 2, "moves are meant to pack two to a 32 bit word");
 
 struct alignas(32) GameStateData {
     char state[64];                 // persisitent
-    int flags;
+    uint8_t castlingRights;         // CastlingRights still available
+    int8_t enPassantSquare;         // square behind a double push a pawn can take on, -1 if none
     char color;                     // BLACK or WHITE
+    uint16_t halfmoveClock;         // plies since the last capture or pawn move
+    uint64_t hash;                  // zobrist key, kept up to date by pushMove
 
-    GameStateData() : flags(0)
-        , color(WHITE) {
+    GameStateData() : castlingRights(0)
+        , enPassantSquare(-1)
+        , color(WHITE)
+        , halfmoveClock(0)
+        , hash(0) {
         std::memset(state, '0', sizeof(state));
     }
     GameStateData(const GameStateData&) = default;
     GameStateData& operator=(const GameStateData&) = default;
 };
 
+// what pushMove can't work out again from the move itself, 16 bytes a ply
+struct UndoRecord {
+    uint64_t hash;
+    uint16_t halfmoveClock;
+    BitMove move;
+    char captured;                  // state character the move landed on, '0' if none
+    uint8_t castlingRights;
+    int8_t enPassantSquare;
+};
+
+// every square each side attacks, worked out once per position and shared by
+// legality, check detection, king safety, mobility and exchange evaluation.
+// sides are indexed 0 for white and 1 for black
+struct AttackMap {
+    uint64_t byPiece[2][7];         // [side][ChessPiece], NoPiece left empty
+    uint64_t bySide[2];             // everything a side attacks
+    uint64_t checkers;              // enemy pieces giving check to the side to move
+    uint64_t pinned;                // side to move's pieces that can only move along the line to their king
+    uint64_t kingDanger;            // enemy attacks with the side to move's king lifted off, where it can't step
+};
+
 class GameState : public GameStateData {
 public:
-    GameStateData stateStack[MAX_DEPTH];
-    int stackPtr = 0;
-
-    uint64_t _zobristHash[2]; // when one hash value is made, the other is made as well because it's just a xor of the first by the color bit
     BitBoard _bitboards[e_numBitboards];
-    BitBoard _attackBitBoard;
 
-    GameState() : stackPtr(0) { }
+    // game and search moves share the stack, so this covers a long game plus a deep search
+    GameState() { _undoStack.reserve(512); }
 
+    // castling rights are taken to be intact for every king and rook still on its home square
     void init(const char* newState, char player);
+    // set up from a FEN string (placement, side to move, castling, en passant and halfmove clock);
+    // false if it doesn't parse
+    bool initFromFEN(std::string_view fen);
+
+    // the move from one square to another in this position, typed as a castle, en passant
+    // or promotion where it is one; for callers that only know the squares (the board, archives)
+    BitMove moveFor(int from, int to, ChessPiece promotion = Queen) const;
 
     inline void pushMove(const BitMove& move) {
-        pushState();
-        unsigned char fromPiece = state[move.from];
-        state[move.from] = '0';
-        state[move.to] = fromPiece;
-        if (move.flags & KingSideCastle) {
-            state[move.to - 1] = state[move.to + 1];
-            state[move.to + 1] = '0';
-        } else if (move.flags & QueenSideCastle) {
-            state[move.to + 1] = state[move.to - 2];
-            state[move.to - 2] = '0';
-        } else if (move.flags & EnPassant) {
+        const int from = move.from();
+        const int to = move.to();
+        const MoveType type = move.type();
+        _undoStack.push_back({ hash, halfmoveClock, move, state[to], castlingRights, enPassantSquare });
+        unsigned char fromPiece = state[from];
+        bool pawnMove = fromPiece == 'P' || fromPiece == 'p';
+        bool irreversible = pawnMove || state[to] != '0';
+        halfmoveClock = irreversible ? 0 : halfmoveClock + 1;
+        if (enPassantSquare >= 0) {
+            hash ^= Zobrist::enPassant(enPassantSquare & 7);
+            enPassantSquare = -1;
+        }
+        hash ^= Zobrist::piece(fromPiece, from) ^ Zobrist::piece(state[to], to);
+        state[from] = '0';
+        state[to] = fromPiece;
+        if (type == CastlingMove) {
+            // the rook jumps over the king: h-file to f-file, or a-file to d-file
+            const int rookFrom = to > from ? to + 1 : to - 2;
+            const int rookTo = to > from ? to - 1 : to + 1;
+            hash ^= Zobrist::piece(state[rookFrom], rookFrom) ^ Zobrist::piece(state[rookFrom], rookTo);
+            state[rookTo] = state[rookFrom];
+            state[rookFrom] = '0';
+        } else if (type == EnPassantMove) {
             // check for color to determine which direction to capture
-            if (fromPiece == 'P') {
-                state[move.to - 8] = '0';
-            } else {
-                state[move.to + 8] = '0';
+            int captureSquare = fromPiece == 'P' ? to - 8 : to + 8;
+            hash ^= Zobrist::piece(state[captureSquare], captureSquare);
+            state[captureSquare] = '0';
+        } else if (type == PromotionMove) {
+            state[to] = pieceCharacter(move.promotion(), color);
+        }
+        hash ^= Zobrist::piece(state[to], to) ^ Zobrist::whiteToMove();
+
+        // a king or rook leaving home, or a rook taken there, gives up those rights for good
+        int lost = castlingRights & (castlingMask(from) | castlingMask(to));
+        if (lost) {
+            castlingRights ^= lost;
+            hash ^= Zobrist::castling(lost);
+        }
+        // a double push only leaves an en passant square when an enemy pawn can take on it,
+        // which keeps the key the same as polyglot's and repetitions honest
+        if (pawnMove && (from ^ to) == 16) {
+            const char enemyPawn = fromPiece == 'P' ? 'p' : 'P';
+            const int file = to & 7;
+            if ((file > 0 && state[to - 1] == enemyPawn) || (file < 7 && state[to + 1] == enemyPawn)) {
+                enPassantSquare = (from + to) / 2;
+                hash ^= Zobrist::enPassant(file);
             }
-        } else if (move.flags & IsPromotion) {
-            state[move.to] = color == WHITE ? 'Q' : 'q';
         }
         // flip the color bit as it now becomes the other player's turn
         color = (color == WHITE) ? BLACK : WHITE;
-        flags = 0; // invalidate all the flags
     }
 
-    inline void pushState() {
-        assert(stackPtr < MAX_DEPTH);
-        stateStack[stackPtr++] = static_cast<const GameStateData&>(*this);
+    // take back the last pushMove
+    inline void popMove() {
+        assert(!_undoStack.empty());
+        const UndoRecord& undo = _undoStack.back();
+        const int from = undo.move.from();
+        const int to = undo.move.to();
+        color = (color == WHITE) ? BLACK : WHITE;
+        switch (undo.move.type()) {
+            case PromotionMove:
+                state[to] = color == WHITE ? 'P' : 'p';
+                break;
+            case CastlingMove: {
+                const int rookFrom = to > from ? to + 1 : to - 2;
+                const int rookTo = to > from ? to - 1 : to + 1;
+                state[rookFrom] = state[rookTo];
+                state[rookTo] = '0';
+                break;
+            }
+            case EnPassantMove:
+                state[color == WHITE ? to - 8 : to + 8] = color == WHITE ? 'p' : 'P';
+                break;
+            default:
+                break;
+        }
+        state[from] = state[to];
+        state[to] = undo.captured;
+        hash = undo.hash;
+        halfmoveClock = undo.halfmoveClock;
+        castlingRights = undo.castlingRights;
+        enPassantSquare = undo.enPassantSquare;
+        _undoStack.pop_back();
     }
-    inline void popState() {
-        assert(stackPtr > 0);
-        static_cast<GameStateData&>(*this) = stateStack[--stackPtr];
+
+    // true if the position was reached before with no capture or pawn move since;
+    // the search treats a single repeat as a draw, the game needs two earlier
+    // occurrences (threefold repetition)
+    bool isRepetition(int count = 1) const {
+        const int plies = (int)_undoStack.size();
+        const int reversible = std::min<int>(halfmoveClock, plies);
+        int found = 0;
+        // the same side is to move every second ply, and a repeat takes at least four
+        for (int back = 4; back <= reversible; back += 2) {
+            if (_undoStack[plies - back].hash == hash && ++found >= count) return true;
+        }
+        return false;
     }
+    bool isFiftyMoveDraw() const { return halfmoveClock >= 100; }
+
+    // zobrist key rebuilt from scratch; hash holds the same value incrementally
+    uint64_t computeHash() const;
 
-    std::vector<BitMove> generateAllMoves();
+    // piece type on a square, NoPiece if empty
+    ChessPiece pieceAt(int square) const {
+        switch (state[square]) {
+            case 'P': case 'p': return Pawn;
+            case 'N': case 'n': return Knight;
+            case 'B': case 'b': return Bishop;
+            case 'R': case 'r': return Rook;
+            case 'Q': case 'q': return Queen;
+            case 'K': case 'k': return King;
+            default: return NoPiece;
+        }
+    }
+
+    int pieceCount() const {
+        int count = 0;
+        for (int square = 0; square < 64; square++) count += state[square] != '0';
+        return count;
+    }
+
+    // legal moves for the side to move; all of them means evasions when in check
+    std::vector<BitMove> generateAllMoves() { return generateMoves(GenAll); }
+    std::vector<BitMove> generateMoves(GenType type);
+    // is the side to move's king attacked; with no legal moves that's mate, without it stalemate
+    bool isInCheck() { return attacks().checkers != 0; }
+    // the attack map for the position as it stands, rebuilt (with _bitboards) only when the key moves on
+    const AttackMap& attacks() {
+        if (!_attackMapValid || _attackMapKey != hash) computeAttackMap();
+        return _attackMap;
+    }
+    // pieces of both sides attacking a square, sliders seen through the given occupancy;
+    // reads _bitboards, so call attacks() first
+    uint64_t attackersTo(int square, uint64_t occupancy) const;
     void shutdown();
 private:
-    const BitBoard generatePawnAttacks(const BitBoard pawns, char color);
-    uint64_t generatePawnAttacksBitBoard(int square, char color);
-    
-    void generateKnightMoves(std::vector<BitMove>& moves, BitBoard knightBoard, uint64_t occupancy);
-    void generateKingMoves(std::vector<BitMove>& moves, BitBoard kingBoard, uint64_t occupancy);
-    void generateRooksMoves(std::vector<BitMove>& moves, BitBoard bishopBoard, uint64_t occupancy, uint64_t friendlies);
-    void generateQueensMoves(std::vector<BitMove>& moves, BitBoard bishopBoard, uint64_t occupancy, uint64_t friendlies);
-
-    void generateBishopMoves(std::vector<BitMove>& moves, BitBoard bishopBoard, uint64_t occupancy, uint64_t friendlies);
-    void generatePawnMoveList(std::vector<BitMove>& moves, const BitBoard pawns, const BitBoard emptySquares, const BitBoard enemyPieces, char color);
-    void addPawnBitboardMovesToList(std::vector<BitMove>& moves, const BitBoard bitboard, const int shift);
-    bool isSquareAttacked(int square, char attackerColor, const BitBoard (&boards)[e_numBitboards]);
+    void buildBitboards();
+    void computeAttackMap();
+
+    // pseudo-legal moves of one kind for one side, filtered by filterOutIllegalMoves
+    template <int Color, GenType Type> void generate(std::vector<BitMove>& moves);
+    template <int Color, GenType Type> void generatePawnMoves(std::vector<BitMove>& moves, uint64_t target);
+    template <ChessPiece Piece> void generatePieceMoves(std::vector<BitMove>& moves, uint64_t pieces, uint64_t target);
+    template <int Color> void generateCastlingMoves(std::vector<BitMove>& moves);
+    bool enPassantExposesKing(const BitMove& move) const;
     void filterOutIllegalMoves(std::vector<BitMove>& moves);
 
+    // one record per move since init, game moves and search moves alike; their
+    // keys are the history repetitions are looked up in
+    std::vector<UndoRecord> _undoStack;
+
+    AttackMap _attackMap;
+    uint64_t _attackMapKey = 0;
+    bool _attackMapValid = false;
 };
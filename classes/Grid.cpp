@@ -1,7 +1,20 @@
 #include "Grid.h"
+#include <algorithm>
+#include <cmath>
+#include <charconv>
 
 Grid::Grid(int width, int height) : _width(width), _height(height)
 {
+    _stateCacheVersion = 0;
+    _hitIndexDirty = true;
+    _hitUniform = false;
+    _hitFlipX = false;
+    _hitFlipY = false;
+    _hitOrigin = ImVec2(0, 0);
+    _hitPitch = ImVec2(0, 0);
+    _hitBucketsX = 0;
+    _hitBucketsY = 0;
+
     // Initialize 2D vectors
     _squares.resize(height);
     _enabled.resize(height);
@@ -54,7 +67,127 @@ void Grid::setEnabled(int x, int y, bool enabled)
 {
     if (isValid(x, y)) {
         _enabled[y][x] = enabled;
+        BitHolder::touchBoard();
+    }
+}
+
+// Hit testing
+ChessSquare* Grid::getSquareAtPoint(const ImVec2& point)
+{
+    if (_hitIndexDirty) {
+        buildHitIndex();
+    }
+
+    if (_hitUniform) {
+        if (point.x < _hitOrigin.x || point.y < _hitOrigin.y) return nullptr;
+        int x = (int)((point.x - _hitOrigin.x) / _hitPitch.x);
+        int y = (int)((point.y - _hitOrigin.y) / _hitPitch.y);
+        if (x >= _width || y >= _height) return nullptr;
+        if (_hitFlipX) x = _width - 1 - x;
+        if (_hitFlipY) y = _height - 1 - y;
+        // the cell may be smaller than its pitch, so still confirm the hit
+        if (!_enabled[y][x] || !_squares[y][x]->isMouseOver(point)) return nullptr;
+        return _squares[y][x];
+    }
+
+    if (_hitBuckets.empty()) return nullptr;
+    if (point.x < _hitOrigin.x || point.y < _hitOrigin.y) return nullptr;
+    int bx = (int)((point.x - _hitOrigin.x) / _hitPitch.x);
+    int by = (int)((point.y - _hitOrigin.y) / _hitPitch.y);
+    if (bx >= _hitBucketsX || by >= _hitBucketsY) return nullptr;
+
+    // match the old full scan: the last square in row-major order wins
+    ChessSquare* hit = nullptr;
+    for (int index : _hitBuckets[by * _hitBucketsX + bx]) {
+        int x, y;
+        getCoordinates(index, x, y);
+        if (_enabled[y][x] && _squares[y][x]->isMouseOver(point)) {
+            hit = _squares[y][x];
+        }
     }
+    return hit;
+}
+
+//
+// work out how point -> square lookups are done for the current layout.
+// boards laid out on a regular lattice (every game we ship) get pure arithmetic,
+// anything hand placed gets a coarse bucket grid so a lookup only checks a few squares
+//
+void Grid::buildHitIndex()
+{
+    _hitIndexDirty = false;
+    _hitUniform = false;
+    _hitBuckets.clear();
+    _hitBucketsX = _hitBucketsY = 0;
+
+    if (_width <= 0 || _height <= 0) return;
+
+    ImVec2 base = _squares[0][0]->getPosition();
+    ImVec2 size = _squares[0][0]->getSize();
+    float stepX = _width > 1 ? _squares[0][1]->getPosition().x - base.x : size.x;
+    float stepY = _height > 1 ? _squares[1][0]->getPosition().y - base.y : size.y;
+
+    bool uniform = size.x > 0.0f && size.y > 0.0f &&
+                   std::fabs(stepX) >= size.x && std::fabs(stepY) >= size.y;
+    for (int y = 0; y < _height && uniform; y++) {
+        for (int x = 0; x < _width && uniform; x++) {
+            const ImVec2& pos = _squares[y][x]->getPosition();
+            const ImVec2& sz = _squares[y][x]->getSize();
+            uniform = pos.x == base.x + stepX * x && pos.y == base.y + stepY * y &&
+                      sz.x == size.x && sz.y == size.y;
+        }
+    }
+
+    if (uniform) {
+        _hitUniform = true;
+        _hitFlipX = stepX < 0.0f;
+        _hitFlipY = stepY < 0.0f;
+        _hitPitch = ImVec2(std::fabs(stepX), std::fabs(stepY));
+        _hitOrigin = ImVec2(_hitFlipX ? base.x + stepX * (_width - 1) : base.x,
+                            _hitFlipY ? base.y + stepY * (_height - 1) : base.y);
+        return;
+    }
+
+    // non-uniform layout: bucket every square by its bounding box
+    float minX = 0, minY = 0, maxX = 0, maxY = 0, cellX = 0, cellY = 0;
+    bool first = true;
+    forEachSquare([&](ChessSquare* square, int x, int y) {
+        const ImVec2& pos = square->getPosition();
+        const ImVec2& sz = square->getSize();
+        if (sz.x <= 0.0f || sz.y <= 0.0f) return;
+        if (first) {
+            minX = pos.x; minY = pos.y; maxX = pos.x + sz.x; maxY = pos.y + sz.y;
+            first = false;
+        }
+        minX = std::min(minX, pos.x);
+        minY = std::min(minY, pos.y);
+        maxX = std::max(maxX, pos.x + sz.x);
+        maxY = std::max(maxY, pos.y + sz.y);
+        cellX = std::max(cellX, sz.x);
+        cellY = std::max(cellY, sz.y);
+    });
+    if (first) return;
+
+    _hitOrigin = ImVec2(minX, minY);
+    _hitPitch = ImVec2(cellX, cellY);
+    _hitBucketsX = (int)((maxX - minX) / cellX) + 1;
+    _hitBucketsY = (int)((maxY - minY) / cellY) + 1;
+    _hitBuckets.assign(_hitBucketsX * _hitBucketsY, std::vector<int>());
+
+    forEachSquare([&](ChessSquare* square, int x, int y) {
+        const ImVec2& pos = square->getPosition();
+        const ImVec2& sz = square->getSize();
+        if (sz.x <= 0.0f || sz.y <= 0.0f) return;
+        int x0 = (int)((pos.x - minX) / cellX);
+        int y0 = (int)((pos.y - minY) / cellY);
+        int x1 = std::min((int)((pos.x + sz.x - minX) / cellX), _hitBucketsX - 1);
+        int y1 = std::min((int)((pos.y + sz.y - minY) / cellY), _hitBucketsY - 1);
+        for (int by = y0; by <= y1; by++) {
+            for (int bx = x0; bx <= x1; bx++) {
+                _hitBuckets[by * _hitBucketsX + bx].push_back(getIndex(x, y));
+            }
+        }
+    });
 }
 
 void Grid::getCoordinates(int index, int& x, int& y) const
@@ -189,6 +322,7 @@ void Grid::initializeChessSquares(float squareSize, const char* spriteName)
             _squares[y][x]->initHolder(position, spriteName, x, y);
         }
     }
+    _hitIndexDirty = true;
 }
 
 void Grid::initializeSquare(int x, int y, float squareSize, const char* spriteName)
@@ -196,28 +330,38 @@ void Grid::initializeSquare(int x, int y, float squareSize, const char* spriteNa
     if (isValid(x, y)) {
         ImVec2 position(squareSize * x + squareSize/2, squareSize * y + squareSize/2);
         _squares[y][x]->initHolder(position, spriteName, x, y);
+        _hitIndexDirty = true;
     }
 }
 
 // State management
-std::string Grid::getStateString() const
+const std::string& Grid::getStateString() const
 {
-    std::string state;
+    if (_stateCacheVersion == BitHolder::boardVersion()) {
+        return _stateCache;
+    }
+
+    // reuse the cached buffer's capacity instead of growing a new string
+    _stateCache.clear();
+    _stateCache.reserve(_width * _height);
+    char digits[12];
 
     for (int y = 0; y < _height; y++) {
         for (int x = 0; x < _width; x++) {
             if (_enabled[y][x]) {
                 Bit* bit = _squares[y][x]->bit();
                 if (bit) {
-                    state += std::to_string(bit->gameTag());
+                    auto result = std::to_chars(digits, digits + sizeof(digits), bit->gameTag());
+                    _stateCache.append(digits, result.ptr);
                 } else {
-                    state += '0';
+                    _stateCache += '0';
                 }
             }
         }
     }
 
-    return state;
+    _stateCacheVersion = BitHolder::boardVersion();
+    return _stateCache;
 }
 
 void Grid::setStateString(const std::string& state)
@@ -53,19 +53,39 @@ public:
     void forEachSquare(std::function<void(ChessSquare*, int x, int y)> func);
     void forEachEnabledSquare(std::function<void(ChessSquare*, int x, int y)> func);
 
+    // Hit testing - returns the enabled square under a point in window space, or nullptr
+    ChessSquare* getSquareAtPoint(const ImVec2& point);
+
     // Initialize squares with positions and sprites
     void initializeChessSquares(float squareSize, const char* spriteName);
     void initializeSquares(float squareSize, const char* spriteName);
     void initializeSquare(int x, int y, float squareSize, const char* spriteName);
 
     // State management (for enabled squares only)
-    std::string getStateString() const;
+    // the string is cached and only rebuilt when the board version changes
+    const std::string& getStateString() const;
     void setStateString(const std::string& state);
 
 private:
+    void buildHitIndex();
+
     std::vector<std::vector<ChessSquare*>> _squares;
     std::vector<std::vector<bool>> _enabled;
     std::unordered_map<int, std::vector<int>> _connections;
+    mutable std::string _stateCache;
+    mutable uint64_t _stateCacheVersion;
     int _width;
     int _height;
+
+    // hit testing: uniform layouts map a point straight to a cell,
+    // anything else falls back to a bucketed spatial index
+    bool _hitIndexDirty;
+    bool _hitUniform;
+    bool _hitFlipX;
+    bool _hitFlipY;
+    ImVec2 _hitOrigin;
+    ImVec2 _hitPitch;
+    int _hitBucketsX;
+    int _hitBucketsY;
+    std::vector<std::vector<int>> _hitBuckets;
 };
\ No newline at end of file
@@ -2,98 +2,18 @@
 #define MAGIC_BITBOARDS_H
 
 #include <stdint.h>
+#include "Bitboard.h"
 
 // Generate rook attacks for a given square and blocking pieces
 static inline uint64_t ratt(int sq, uint64_t block) {
-    uint64_t result = 0ULL;
-    int rk = sq / 8, fl = sq % 8, r, f;
-
-    // North
-    for (r = rk + 1; r <= 7; r++) {
-        result |= (1ULL << (fl + r * 8));
-        if (block & (1ULL << (fl + r * 8))) break;
-    }
-    // South
-    for (r = rk - 1; r >= 0; r--) {
-        result |= (1ULL << (fl + r * 8));
-        if (block & (1ULL << (fl + r * 8))) break;
-    }
-    // East
-    for (f = fl + 1; f <= 7; f++) {
-        result |= (1ULL << (f + rk * 8));
-        if (block & (1ULL << (f + rk * 8))) break;
-    }
-    // West
-    for (f = fl - 1; f >= 0; f--) {
-        result |= (1ULL << (f + rk * 8));
-        if (block & (1ULL << (f + rk * 8))) break;
-    }
-    return result;
+    return rookSlideAttacks(squareMask(sq), ~block);
 }
 
 // Generate bishop attacks for a given square and blocking pieces
 static inline uint64_t batt(int sq, uint64_t block) {
-    uint64_t result = 0ULL;
-    int rk = sq / 8, fl = sq % 8, r, f;
-
-    // Northeast
-    for (r = rk + 1, f = fl + 1; r <= 7 && f <= 7; r++, f++) {
-        result |= (1ULL << (f + r * 8));
-        if (block & (1ULL << (f + r * 8))) break;
-    }
-    // Southeast
-    for (r = rk - 1, f = fl + 1; r >= 0 && f <= 7; r--, f++) {
-        result |= (1ULL << (f + r * 8));
-        if (block & (1ULL << (f + r * 8))) break;
-    }
-    // Southwest
-    for (r = rk - 1, f = fl - 1; r >= 0 && f >= 0; r--, f--) {
-        result |= (1ULL << (f + r * 8));
-        if (block & (1ULL << (f + r * 8))) break;
-    }
-    // Northwest
-    for (r = rk + 1, f = fl - 1; r <= 7 && f >= 0; r++, f--) {
-        result |= (1ULL << (f + r * 8));
-        if (block & (1ULL << (f + r * 8))) break;
-    }
-    return result;
+    return bishopSlideAttacks(squareMask(sq), ~block);
 }
 
-// Compiler-specific bit manipulation functions
-#ifdef __clang__
-    // Clang/LLVM specific bit counting
-    static inline int countOnes(uint64_t b) {
-        return __builtin_popcountll(b);
-    }
-
-    // Find first set bit (returns 0-63, undefined for b==0)
-    static inline int getFirstBit(uint64_t b) {
-        return __builtin_ctzll(b);
-    }
-#else
-    // Fallback bit counting implementation
-    static inline int countOnes(uint64_t b) {
-        int r = 0;
-        while (b) {
-            r++;
-            b &= b - 1;
-        }
-        return r;
-    }
-
-    // Fallback first bit implementation
-    static inline int getFirstBit(uint64_t b) {
-        const int BitTable[64] = {
-            63, 30, 3, 32, 25, 41, 22, 33, 15, 50, 42, 13, 11, 53, 19, 34,
-            61, 29, 2, 51, 21, 43, 45, 10, 18, 47, 1, 54, 9, 57, 0, 35,
-            62, 31, 40, 4, 49, 5, 52, 26, 60, 6, 23, 44, 46, 27, 56, 16,
-            7, 39, 48, 24, 59, 14, 12, 55, 38, 28, 58, 20, 37, 17, 36, 8
-        };
-        uint64_t debruijn = 0x03f79d71b4cb0a89ULL;
-        return BitTable[((b ^ (b-1)) * debruijn) >> 58];
-    }
-#endif
-
 // Convert index to bitboard configuration
 static inline uint64_t indexToUint64(int index, int bits, uint64_t m) {
     uint64_t result = 0ULL;
@@ -107,26 +27,6 @@ static inline uint64_t indexToUint64(int index, int bits, uint64_t m) {
     return result;
 }
 
-// Bitboard manipulation macros
-#define SET_BIT(bb, sq) ((bb) |= (1ULL << (sq)))
-#define CLEAR_BIT(bb, sq) ((bb) &= ~(1ULL << (sq)))
-#define GET_BIT(bb, sq) ((bb) & (1ULL << (sq)))
-#define SQUARE(rank, file) ((rank) * 8 + (file))
-
-// Directional shift macros
-#define NORTH(bb) ((bb) << 8)
-#define SOUTH(bb) ((bb) >> 8)
-#define EAST(bb) (((bb) & ~0x8080808080808080ULL) << 1)
-#define WEST(bb) (((bb) & ~0x0101010101010101ULL) >> 1)
-#define NORTH_EAST(bb) (((bb) & ~0x8080808080808080ULL) << 9)
-#define NORTH_WEST(bb) (((bb) & ~0x0101010101010101ULL) << 7)
-#define SOUTH_EAST(bb) (((bb) & ~0x8080808080808080ULL) >> 7)
-#define SOUTH_WEST(bb) (((bb) & ~0x0101010101010101ULL) >> 9)
-
-// Pawn attack macros
-#define WHITE_PAWN_ATTACKS(pawns) (NORTH_EAST(pawns) | NORTH_WEST(pawns))
-#define BLACK_PAWN_ATTACKS(pawns) (SOUTH_EAST(pawns) | SOUTH_WEST(pawns))
-
 // Size of attack tables for each square
 const int RAttackSize[64] = {
   4096,
@@ -836,7 +736,7 @@ void initMagicBitboards(void) {
     for (square = 0; square < 64; square++) {
         RAttacks[square] = new uint64_t[RAttackSize[square]];
         uint64_t mask = RMasks[square];
-        int bits = countOnes(mask);
+        int bits = popCount(mask);
         int n = 1 << bits;
 
         for (i = 0; i < n; i++) {
@@ -850,7 +750,7 @@ void initMagicBitboards(void) {
     for (square = 0; square < 64; square++) {
         BAttacks[square] = new uint64_t[BAttackSize[square]];
         uint64_t mask = BMasks[square];
-        int bits = countOnes(mask);
+        int bits = popCount(mask);
         int n = 1 << bits;
 
         for (i = 0; i < n; i++) {
@@ -0,0 +1,88 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() : _data(nullptr), _size(0)
+{
+#ifdef _WIN32
+    _fileHandle = nullptr;
+    _mappingHandle = nullptr;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const std::string& path, bool sequential)
+{
+    close();
+
+#ifdef _WIN32
+    DWORD hints = FILE_ATTRIBUTE_NORMAL | (sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS);
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                              OPEN_EXISTING, hints, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        CloseHandle(file);
+        return false;
+    }
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    _fileHandle = file;
+    _mappingHandle = mapping;
+    _data = static_cast<const uint8_t*>(view);
+    _size = (uint64_t)size.QuadPart;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    void* view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED) return false;
+    madvise(view, (size_t)st.st_size, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+    _data = static_cast<const uint8_t*>(view);
+    _size = (uint64_t)st.st_size;
+#endif
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (_data) {
+#ifdef _WIN32
+        UnmapViewOfFile(_data);
+        CloseHandle((HANDLE)_mappingHandle);
+        CloseHandle((HANDLE)_fileHandle);
+        _mappingHandle = nullptr;
+        _fileHandle = nullptr;
+#else
+        munmap(const_cast<uint8_t*>(_data), (size_t)_size);
+#endif
+    }
+    _data = nullptr;
+    _size = 0;
+}
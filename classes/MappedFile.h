@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+//
+// read-only memory mapping of a whole file (mmap, or MapViewOfFile on windows)
+//
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // sequential hints the OS to read ahead, use it for files walked front to back
+    bool open(const std::string& path, bool sequential = false);
+    void close();
+    bool isOpen() const { return _data != nullptr; }
+
+    const uint8_t* data() const { return _data; }
+    uint64_t size() const { return _size; }
+
+private:
+    const uint8_t* _data;
+    uint64_t _size;
+#ifdef _WIN32
+    void* _fileHandle;
+    void* _mappingHandle;
+#endif
+};
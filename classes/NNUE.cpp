@@ -0,0 +1,375 @@
+#include "NNUE.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+// the AVX2 and SSE4.1 kernels are built whenever the compiler can target x86, and the
+// best one the CPU runs is picked at startup
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define NNUE_X86 1
+#define AVX2_TARGET __attribute__((target("avx2")))
+#define SSE41_TARGET __attribute__((target("sse4.1")))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define NNUE_X86 1
+#define AVX2_TARGET
+#define SSE41_TARGET
+#include <intrin.h>
+#endif
+
+#if defined(NNUE_X86)
+#include <immintrin.h>
+#endif
+
+static constexpr uint32_t kVersion = 0x7AF32F16;
+// the output is in units where a pawn is 208, as the networks were trained
+static constexpr int kOutputScale = 16;
+static constexpr int kPawnValue = 208;
+// hidden layer sums carry 6 bits of fraction from the int8 weights
+static constexpr int kWeightScaleBits = 6;
+
+//
+// kernels
+//
+
+enum NNUEKernel
+{
+    ScalarKernel,
+    SSE41Kernel,
+    AVX2Kernel
+};
+
+static NNUEKernel detectKernel()
+{
+#if defined(__AVX2__)
+    return AVX2Kernel;
+#elif defined(NNUE_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    const int highest = info[0];
+    __cpuid(info, 1);
+    const bool sse41 = (info[2] & (1 << 19)) != 0;
+    // the OS has to save the ymm registers as well
+    const bool ymm = (info[2] & (1 << 27)) && (_xgetbv(0) & 6) == 6;
+    if (highest >= 7 && ymm) {
+        __cpuidex(info, 7, 0);
+        if (info[1] & (1 << 5)) return AVX2Kernel;
+    }
+    return sse41 ? SSE41Kernel : ScalarKernel;
+#elif defined(NNUE_X86)
+    // this runs from a static initialiser, possibly ahead of libgcc's own
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return AVX2Kernel;
+    return __builtin_cpu_supports("sse4.1") ? SSE41Kernel : ScalarKernel;
+#else
+    return ScalarKernel;
+#endif
+}
+
+static const NNUEKernel kKernel = detectKernel();
+
+#if defined(NNUE_X86)
+AVX2_TARGET static void applyRowsAVX2(const int16_t* parent, int16_t* child,
+                                      const int16_t* const* sub, int subCount, const int16_t* const* add, int addCount)
+{
+    for (int j = 0; j < NNUENetwork::kHalfDimensions; j += 16) {
+        __m256i sum = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(parent + j));
+        for (int i = 0; i < subCount; i++) sum = _mm256_sub_epi16(sum, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(sub[i] + j)));
+        for (int i = 0; i < addCount; i++) sum = _mm256_add_epi16(sum, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(add[i] + j)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(child + j), sum);
+    }
+}
+
+SSE41_TARGET static void applyRowsSSE41(const int16_t* parent, int16_t* child,
+                                        const int16_t* const* sub, int subCount, const int16_t* const* add, int addCount)
+{
+    for (int j = 0; j < NNUENetwork::kHalfDimensions; j += 8) {
+        __m128i sum = _mm_loadu_si128(reinterpret_cast<const __m128i*>(parent + j));
+        for (int i = 0; i < subCount; i++) sum = _mm_sub_epi16(sum, _mm_loadu_si128(reinterpret_cast<const __m128i*>(sub[i] + j)));
+        for (int i = 0; i < addCount; i++) sum = _mm_add_epi16(sum, _mm_loadu_si128(reinterpret_cast<const __m128i*>(add[i] + j)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(child + j), sum);
+    }
+}
+
+AVX2_TARGET static void clampHalfAVX2(const int16_t* half, uint8_t* output)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    for (int j = 0; j < NNUENetwork::kHalfDimensions; j += 32) {
+        __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(half + j));
+        __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(half + j + 16));
+        // packs works within 128 bit lanes, the permute puts the quarters back in order
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(low, high), 0xd8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + j), _mm256_max_epi8(packed, zero));
+    }
+}
+
+SSE41_TARGET static void clampHalfSSE41(const int16_t* half, uint8_t* output)
+{
+    const __m128i zero = _mm_setzero_si128();
+    for (int j = 0; j < NNUENetwork::kHalfDimensions; j += 16) {
+        __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(half + j));
+        __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(half + j + 8));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + j), _mm_max_epi8(_mm_packs_epi16(low, high), zero));
+    }
+}
+
+AVX2_TARGET static int32_t dotAVX2(const uint8_t* input, const int8_t* weights, int length)
+{
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i sum = _mm256_setzero_si256();
+    for (int j = 0; j < length; j += 32) {
+        // activations are at most 127, so the pairwise int16 sums can't saturate
+        __m256i products = _mm256_maddubs_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + j)),
+                                                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + j)));
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(products, ones));
+    }
+    __m128i total = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    total = _mm_hadd_epi32(total, total);
+    total = _mm_hadd_epi32(total, total);
+    return _mm_cvtsi128_si32(total);
+}
+
+SSE41_TARGET static int32_t dotSSE41(const uint8_t* input, const int8_t* weights, int length)
+{
+    const __m128i ones = _mm_set1_epi16(1);
+    __m128i sum = _mm_setzero_si128();
+    for (int j = 0; j < length; j += 16) {
+        __m128i products = _mm_maddubs_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(input + j)),
+                                             _mm_loadu_si128(reinterpret_cast<const __m128i*>(weights + j)));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(products, ones));
+    }
+    sum = _mm_hadd_epi32(sum, sum);
+    sum = _mm_hadd_epi32(sum, sum);
+    return _mm_cvtsi128_si32(sum);
+}
+#endif
+
+// child = parent - every row in sub + every row in add, over one 256 wide half
+static void applyRows(const int16_t* parent, int16_t* child,
+                      const int16_t* const* sub, int subCount, const int16_t* const* add, int addCount)
+{
+#if defined(NNUE_X86)
+    if (kKernel == AVX2Kernel) return applyRowsAVX2(parent, child, sub, subCount, add, addCount);
+    if (kKernel == SSE41Kernel) return applyRowsSSE41(parent, child, sub, subCount, add, addCount);
+#endif
+    for (int j = 0; j < NNUENetwork::kHalfDimensions; j++) {
+        int16_t sum = parent[j];
+        for (int i = 0; i < subCount; i++) sum -= sub[i][j];
+        for (int i = 0; i < addCount; i++) sum += add[i][j];
+        child[j] = sum;
+    }
+}
+
+// an accumulator half clamped to 0..127 as the first layer's activations
+static void clampHalf(const int16_t* half, uint8_t* output)
+{
+#if defined(NNUE_X86)
+    if (kKernel == AVX2Kernel) return clampHalfAVX2(half, output);
+    if (kKernel == SSE41Kernel) return clampHalfSSE41(half, output);
+#endif
+    for (int j = 0; j < NNUENetwork::kHalfDimensions; j++) {
+        output[j] = (uint8_t)std::clamp<int>(half[j], 0, 127);
+    }
+}
+
+// activations times int8 weights, length a multiple of 32
+static int32_t dot(const uint8_t* input, const int8_t* weights, int length)
+{
+#if defined(NNUE_X86)
+    if (kKernel == AVX2Kernel) return dotAVX2(input, weights, length);
+    if (kKernel == SSE41Kernel) return dotSSE41(input, weights, length);
+#endif
+    int32_t sum = 0;
+    for (int j = 0; j < length; j++) sum += input[j] * weights[j];
+    return sum;
+}
+
+static uint8_t clippedReLU(int32_t sum)
+{
+    return (uint8_t)std::clamp(sum >> kWeightScaleBits, 0, 127);
+}
+
+//
+// features
+//
+
+static int kingSquare(const char* state, int perspective)
+{
+    const void* king = std::memchr(state, perspective == 0 ? 'K' : 'k', 64);
+    return king ? (int)(static_cast<const char*>(king) - state) : -1;
+}
+
+// the input for a piece (not a king) on a square, from one side with its king, already turned round, on 'king'
+static int featureIndex(int perspective, int king, char piece, int square)
+{
+    int type;
+    switch (piece) {
+        case 'P': case 'p': type = 0; break;
+        case 'N': case 'n': type = 1; break;
+        case 'B': case 'b': type = 2; break;
+        case 'R': case 'r': type = 3; break;
+        default: type = 4; break;
+    }
+    const bool own = (piece < 'a') == (perspective == 0);
+    const int orient = perspective == 0 ? 0 : 63;
+    return king * NNUENetwork::kPieceSquares + 1 + (type * 2 + (own ? 0 : 1)) * 64 + (square ^ orient);
+}
+
+//
+// NNUENetwork
+//
+
+template <typename T>
+static bool readArray(std::istream& in, std::vector<T>& values, size_t count)
+{
+    // the file is little endian, as are the machines this runs on
+    values.resize(count);
+    return (bool)in.read(reinterpret_cast<char*>(values.data()), (std::streamsize)(count * sizeof(T)));
+}
+
+template <typename T>
+static bool readValue(std::istream& in, T& value)
+{
+    return (bool)in.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+bool NNUENetwork::load(const std::string& path)
+{
+    _loaded = false;
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+
+    uint32_t version, hash, length;
+    if (!readValue(in, version) || !readValue(in, hash) || !readValue(in, length) || version != kVersion) return false;
+    _description.resize(length);
+    if (!in.read(_description.data(), length)) return false;
+
+    std::vector<int32_t> output;
+    bool read = readValue(in, hash) &&
+                readArray(in, _transformerBiases, kHalfDimensions) &&
+                readArray(in, _transformerWeights, (size_t)kInputs * kHalfDimensions) &&
+                readValue(in, hash) &&
+                readArray(in, _hidden1Biases, kHidden) &&
+                readArray(in, _hidden1Weights, (size_t)kHidden * kHalfDimensions * 2) &&
+                readArray(in, _hidden2Biases, kHidden) &&
+                readArray(in, _hidden2Weights, (size_t)kHidden * kHidden) &&
+                readValue(in, _outputBias) &&
+                readArray(in, _outputWeights, kHidden);
+    // anything left over means the file is some other shape
+    _loaded = read && in.peek() == std::char_traits<char>::eof();
+    return _loaded;
+}
+
+void NNUENetwork::refreshHalf(const char* state, int perspective, int16_t* half) const
+{
+    const int king = kingSquare(state, perspective);
+    if (king < 0) return;
+    const int oriented = perspective == 0 ? king : king ^ 63;
+    // rows go in a few at a time so each slice of the half stays in registers
+    const int16_t* rows[8];
+    int count = 0;
+    for (int square = 0; square < 64; square++) {
+        const char piece = state[square];
+        if (piece == '0' || piece == 'K' || piece == 'k') continue;
+        rows[count++] = &_transformerWeights[(size_t)featureIndex(perspective, oriented, piece, square) * kHalfDimensions];
+        if (count == 8) {
+            applyRows(half, half, nullptr, 0, rows, count);
+            count = 0;
+        }
+    }
+    applyRows(half, half, nullptr, 0, rows, count);
+}
+
+void NNUENetwork::refresh(const GameState& position, NNUEAccumulator& accumulator) const
+{
+    for (int perspective = 0; perspective < 2; perspective++) {
+        std::memcpy(accumulator.values[perspective], _transformerBiases.data(), sizeof(accumulator.values[perspective]));
+        refreshHalf(position.state, perspective, accumulator.values[perspective]);
+    }
+}
+
+void NNUENetwork::update(const GameState& position, const BitMove& move, const NNUEAccumulator& parent, NNUEAccumulator& child) const
+{
+    const int from = move.from();
+    const int to = move.to();
+    const char mover = position.state[from];
+    const int moverSide = mover < 'a' ? 0 : 1;
+    const bool kingMove = mover == 'K' || mover == 'k';
+
+    // what the move takes off the board and puts on it, kings aside
+    struct Change { char piece; int square; };
+    Change removed[2], added[2];
+    int removedCount = 0, addedCount = 0;
+    if (!kingMove) {
+        removed[removedCount++] = { mover, from };
+        added[addedCount++] = { move.type() == PromotionMove ? pieceCharacter(move.promotion(), position.color) : mover, to };
+    }
+    if (move.type() == EnPassantMove) {
+        removed[removedCount++] = { mover == 'P' ? 'p' : 'P', mover == 'P' ? to - 8 : to + 8 };
+    } else if (position.state[to] != '0') {
+        removed[removedCount++] = { position.state[to], to };
+    }
+    const int rookFrom = to > from ? to + 1 : to - 2;
+    const int rookTo = to > from ? to - 1 : to + 1;
+    if (move.type() == CastlingMove) {
+        removed[removedCount++] = { position.state[rookFrom], rookFrom };
+        added[addedCount++] = { position.state[rookFrom], rookTo };
+    }
+
+    for (int perspective = 0; perspective < 2; perspective++) {
+        if (kingMove && perspective == moverSide) {
+            // every input of this side is relative to its king, so start over from the board after the move
+            char after[64];
+            std::memcpy(after, position.state, sizeof(after));
+            after[to] = mover;
+            after[from] = '0';
+            if (move.type() == CastlingMove) {
+                after[rookTo] = after[rookFrom];
+                after[rookFrom] = '0';
+            }
+            std::memcpy(child.values[perspective], _transformerBiases.data(), sizeof(child.values[perspective]));
+            refreshHalf(after, perspective, child.values[perspective]);
+            continue;
+        }
+
+        const int king = kingSquare(position.state, perspective);
+        const int oriented = perspective == 0 ? king : king ^ 63;
+        const int16_t* sub[2];
+        const int16_t* add[2];
+        for (int i = 0; i < removedCount; i++) {
+            sub[i] = &_transformerWeights[(size_t)featureIndex(perspective, oriented, removed[i].piece, removed[i].square) * kHalfDimensions];
+        }
+        for (int i = 0; i < addedCount; i++) {
+            add[i] = &_transformerWeights[(size_t)featureIndex(perspective, oriented, added[i].piece, added[i].square) * kHalfDimensions];
+        }
+        applyRows(parent.values[perspective], child.values[perspective], sub, removedCount, add, addedCount);
+    }
+}
+
+const char* NNUENetwork::kernel()
+{
+    switch (kKernel) {
+        case AVX2Kernel: return "AVX2";
+        case SSE41Kernel: return "SSE4.1";
+        default: return "scalar";
+    }
+}
+
+int NNUENetwork::evaluate(const NNUEAccumulator& accumulator, char sideToMove) const
+{
+    // the side to move's half first, then the other side's
+    alignas(32) uint8_t input[kHalfDimensions * 2];
+    const int us = sideToMove == WHITE ? 0 : 1;
+    clampHalf(accumulator.values[us], input);
+    clampHalf(accumulator.values[us ^ 1], input + kHalfDimensions);
+
+    alignas(32) uint8_t hidden1[kHidden];
+    for (int i = 0; i < kHidden; i++) {
+        hidden1[i] = clippedReLU(_hidden1Biases[i] + dot(input, &_hidden1Weights[(size_t)i * kHalfDimensions * 2], kHalfDimensions * 2));
+    }
+    alignas(32) uint8_t hidden2[kHidden];
+    for (int i = 0; i < kHidden; i++) {
+        hidden2[i] = clippedReLU(_hidden2Biases[i] + dot(hidden1, &_hidden2Weights[(size_t)i * kHidden], kHidden));
+    }
+    const int32_t output = _outputBias + dot(hidden2, _outputWeights.data(), kHidden);
+    return output / kOutputScale * 100 / kPawnValue;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "GameState.h"
+
+//
+// NNUE evaluation, HalfKP 256x2-32-32-1
+//
+// the inputs are (own king square, piece, square) for every piece but the
+// kings, seen from each side: 64 king squares x 641 piece-squares = 41024 per
+// side. black sees the board turned round (square ^ 63), so both sides share
+// one set of first layer weights. the first layer's sums for a side, its half
+// of the accumulator, only change by a few weight rows per move, so the search
+// keeps an accumulator per ply and works each one out from its parent; a king
+// move rebuilds that side's half from scratch, since every input moves with it.
+//
+// file layout, little endian:
+//   uint32 version (0x7AF32F16), uint32 hash, uint32 n, n bytes description
+//   uint32 hash, int16 biases[256], int16 weights[41024][256]     feature transformer
+//   uint32 hash, int32 biases[32], int8 weights[32][512]          hidden layer 1
+//                int32 biases[32], int8 weights[32][32]           hidden layer 2
+//                int32 bias, int8 weights[32]                     output
+//
+// the kernels come in AVX2, SSE4.1 and plain loop versions. the vector ones are
+// built for any x86 target and the best the CPU runs is picked at startup, so
+// they don't wait on CHESS_NATIVE_ARCH. tools/pstbench times them against the
+// hand-written evaluation.
+//
+
+struct alignas(32) NNUEAccumulator
+{
+    int16_t values[2][256];     // [0 white's view, 1 black's]
+};
+
+class NNUENetwork
+{
+public:
+    static constexpr int kHalfDimensions = 256;
+    static constexpr int kPieceSquares = 641;
+    static constexpr int kInputs = 64 * kPieceSquares;
+    static constexpr int kHidden = 32;
+
+    // false if the file is missing or isn't a network of this shape
+    bool load(const std::string& path);
+    bool isLoaded() const { return _loaded; }
+    const std::string& description() const { return _description; }
+
+    // both halves of the accumulator worked out from the board
+    void refresh(const GameState& position, NNUEAccumulator& accumulator) const;
+    // child = parent after 'move'; 'position' is the board before the move is played
+    void update(const GameState& position, const BitMove& move, const NNUEAccumulator& parent, NNUEAccumulator& child) const;
+    // score for the side to move, in centipawns
+    int evaluate(const NNUEAccumulator& accumulator, char sideToMove) const;
+
+    // the kernels this machine runs: "AVX2", "SSE4.1" or "scalar"
+    static const char* kernel();
+
+private:
+    void refreshHalf(const char* state, int perspective, int16_t* half) const;
+
+    bool _loaded = false;
+    std::string _description;
+    std::vector<int16_t> _transformerBiases;
+    std::vector<int16_t> _transformerWeights;
+    std::vector<int32_t> _hidden1Biases;
+    std::vector<int8_t> _hidden1Weights;
+    std::vector<int32_t> _hidden2Biases;
+    std::vector<int8_t> _hidden2Weights;
+    int32_t _outputBias = 0;
+    std::vector<int8_t> _outputWeights;
+};
@@ -0,0 +1,98 @@
+#include "OpeningBook.h"
+#include <algorithm>
+
+static inline uint64_t fromBigEndian64(uint64_t value)
+{
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+    uint64_t result = 0;
+    for (int i = 0; i < 8; i++) result = (result << 8) | bytes[i];
+    return result;
+}
+
+static inline uint16_t fromBigEndian16(uint16_t value)
+{
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+    return (uint16_t)((bytes[0] << 8) | bytes[1]);
+}
+
+uint64_t OpeningBook::readKey(const PolyglotEntry& entry) { return fromBigEndian64(entry.key); }
+uint16_t OpeningBook::readMove(const PolyglotEntry& entry) { return fromBigEndian16(entry.move); }
+uint16_t OpeningBook::readWeight(const PolyglotEntry& entry) { return fromBigEndian16(entry.weight); }
+
+void OpeningBook::writeEntry(PolyglotEntry& entry, uint64_t key, uint16_t move, uint16_t weight, uint32_t learn)
+{
+    uint8_t* bytes = reinterpret_cast<uint8_t*>(&entry);
+    for (int i = 0; i < 8; i++) bytes[i] = (uint8_t)(key >> (56 - 8 * i));
+    bytes[8] = (uint8_t)(move >> 8);
+    bytes[9] = (uint8_t)move;
+    bytes[10] = (uint8_t)(weight >> 8);
+    bytes[11] = (uint8_t)weight;
+    for (int i = 0; i < 4; i++) bytes[12 + i] = (uint8_t)(learn >> (24 - 8 * i));
+}
+
+bool OpeningBook::open(const std::string& path)
+{
+    close();
+    if (!_file.open(path)) return false;
+    if (_file.size() < sizeof(PolyglotEntry) || _file.size() % sizeof(PolyglotEntry) != 0) {
+        _file.close();
+        return false;
+    }
+    _entries = reinterpret_cast<const PolyglotEntry*>(_file.data());
+    _count = (size_t)(_file.size() / sizeof(PolyglotEntry));
+    return true;
+}
+
+void OpeningBook::close()
+{
+    _file.close();
+    _entries = nullptr;
+    _count = 0;
+}
+
+size_t OpeningBook::moves(uint64_t key, std::vector<BookMove>& out) const
+{
+    out.clear();
+    if (!_entries) return 0;
+
+    // first entry with this key; the file is sorted so this is a plain binary search
+    const PolyglotEntry* first = std::lower_bound(_entries, _entries + _count, key, [](const PolyglotEntry& entry, uint64_t k) {
+        return readKey(entry) < k;
+    });
+    for (const PolyglotEntry* entry = first; entry < _entries + _count && readKey(*entry) == key; entry++) {
+        uint16_t move = readMove(*entry);
+        out.push_back({ polyglotMoveFrom(move), polyglotMoveTo(move), polyglotMovePromotion(move), readWeight(*entry) });
+    }
+    std::stable_sort(out.begin(), out.end(), [](const BookMove& a, const BookMove& b) {
+        return a.weight > b.weight;
+    });
+    return out.size();
+}
+
+bool OpeningBook::probe(uint64_t key, BookMove& move, BookSelection selection)
+{
+    std::vector<BookMove> candidates;
+    if (moves(key, candidates) == 0) return false;
+
+    if (selection == BookSelectBest) {
+        move = candidates[0];
+        return true;
+    }
+
+    uint32_t total = 0;
+    for (const BookMove& candidate : candidates) total += candidate.weight;
+    if (total == 0) {
+        move = candidates[0];
+        return true;
+    }
+    uint32_t pick = std::uniform_int_distribution<uint32_t>(0, total - 1)(_random);
+    for (const BookMove& candidate : candidates) {
+        if (pick < candidate.weight) {
+            move = candidate;
+            return true;
+        }
+        pick -= candidate.weight;
+    }
+    move = candidates[0];
+    return true;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+
+//
+// polyglot opening book (.bin)
+//
+// the file is a flat array of 16 byte big endian entries sorted by key:
+//   uint64 key, uint16 move, uint16 weight, uint32 learn
+// a move packs to file/rank in bits 0-5, from file/rank in bits 6-11 and the
+// promotion piece (1 knight .. 4 queen) in bits 12-14. castling is stored as
+// the king taking its own rook (e1h1); the caller knows the board and turns it
+// back into e1g1.
+//
+// keys are the ones GameState::hash produces, see Zobrist.h.
+//
+
+#pragma pack(push, 1)
+struct PolyglotEntry
+{
+    uint64_t key;
+    uint16_t move;
+    uint16_t weight;
+    uint32_t learn;
+};
+#pragma pack(pop)
+
+constexpr int polyglotMoveTo(uint16_t move) { return move & 0x3f; }
+constexpr int polyglotMoveFrom(uint16_t move) { return (move >> 6) & 0x3f; }
+constexpr int polyglotMovePromotion(uint16_t move) { return (move >> 12) & 0x7; }
+constexpr uint16_t makePolyglotMove(int from, int to, int promotion = 0)
+{
+    return (uint16_t)((to & 0x3f) | ((from & 0x3f) << 6) | ((promotion & 0x7) << 12));
+}
+
+struct BookMove
+{
+    int from;
+    int to;
+    int promotion;      // 0 none, 1 knight, 2 bishop, 3 rook, 4 queen
+    uint16_t weight;
+};
+
+enum BookSelection
+{
+    BookSelectWeighted,     // random, in proportion to the weights
+    BookSelectBest          // always the heaviest move
+};
+
+class OpeningBook
+{
+public:
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return _entries != nullptr; }
+    size_t entryCount() const { return _count; }
+
+    // every book move for the position, heaviest first
+    size_t moves(uint64_t key, std::vector<BookMove>& out) const;
+
+    // pick one move for the position, false if the book has nothing
+    bool probe(uint64_t key, BookMove& move, BookSelection selection = BookSelectWeighted);
+
+    // polyglot files are big endian
+    static uint64_t readKey(const PolyglotEntry& entry);
+    static uint16_t readMove(const PolyglotEntry& entry);
+    static uint16_t readWeight(const PolyglotEntry& entry);
+    static void writeEntry(PolyglotEntry& entry, uint64_t key, uint16_t move, uint16_t weight, uint32_t learn = 0);
+
+private:
+    MappedFile _file;
+    const PolyglotEntry* _entries = nullptr;
+    size_t _count = 0;
+    std::mt19937 _random{ std::random_device{}() };
+};
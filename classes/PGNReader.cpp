@@ -0,0 +1,246 @@
+#include "PGNReader.h"
+#include <algorithm>
+#include <cstring>
+
+static inline bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+
+static inline bool isResult(std::string_view token)
+{
+    return token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*";
+}
+
+// a move's annotation written apart from it ("!?", "+/=", "+-"), or a "--" null move
+static inline bool isAnnotation(std::string_view token)
+{
+    return token.find_first_not_of("!?+-=/") == std::string_view::npos;
+}
+
+bool PGNReader::open(const std::string& path)
+{
+    close();
+    if (!_file.open(path, true)) return false;
+    setText(std::string_view(reinterpret_cast<const char*>(_file.data()), (size_t)_file.size()));
+    return true;
+}
+
+void PGNReader::setText(std::string_view text)
+{
+    _begin = _cursor = text.data();
+    _end = text.data() + text.size();
+    _stats = Stats();
+    _stats.bytes = text.size();
+}
+
+void PGNReader::close()
+{
+    _file.close();
+    _begin = _cursor = _end = nullptr;
+}
+
+void PGNReader::skipWhitespace()
+{
+    while (_cursor < _end && isSpace(*_cursor)) _cursor++;
+}
+
+void PGNReader::skipLine()
+{
+    const void* newline = std::memchr(_cursor, '\n', _end - _cursor);
+    _cursor = newline ? static_cast<const char*>(newline) + 1 : _end;
+}
+
+bool PGNReader::atTag() const
+{
+    return _cursor < _end && *_cursor == '[';
+}
+
+uint64_t PGNReader::read(PGNVisitor& visitor)
+{
+    uint64_t games = 0;
+    while (true) {
+        skipWhitespace();
+        if (_cursor >= _end) break;
+        if (readGame(visitor)) games++;
+    }
+    return games;
+}
+
+//
+// one game: tag pairs, then movetext up to a result token or the next tag section
+//
+bool PGNReader::readGame(PGNVisitor& visitor)
+{
+    bool wanted = visitor.beginGame();
+    std::string_view fen;
+
+    // tag pairs: [Name "value"]
+    while (atTag()) {
+        const char* p = _cursor + 1;
+        const char* nameStart = p;
+        while (p < _end && !isSpace(*p) && *p != '"' && *p != ']') p++;
+        std::string_view name(nameStart, p - nameStart);
+        while (p < _end && *p != '"' && *p != ']' && *p != '\n') p++;
+        std::string_view value;
+        if (p < _end && *p == '"') {
+            const char* valueStart = ++p;
+            while (p < _end && *p != '"' && *p != '\n') {
+                if (*p == '\\' && p + 1 < _end) p++;
+                p++;
+            }
+            value = std::string_view(valueStart, p - valueStart);
+        }
+        _cursor = p;
+        skipLine();
+        skipWhitespace();
+        if (wanted) visitor.tag(name, value);
+        if (name == "FEN") fen = value;
+    }
+
+    if (!fen.empty()) {
+        if (!_position.initFromFEN(fen)) wanted = false;
+    } else {
+        _position.init(kStartingState, WHITE);
+    }
+    bool replaying = wanted && visitor.beginMoves(_position);
+    std::string_view result = "*";
+
+    // movetext
+    int variationDepth = 0;
+    while (_cursor < _end) {
+        skipWhitespace();
+        if (_cursor >= _end) break;
+        char c = *_cursor;
+
+        if (c == '[' && variationDepth == 0) {
+            // next game's tags without a result token
+            break;
+        }
+        if (c == '{') {
+            const void* close = std::memchr(_cursor, '}', _end - _cursor);
+            _cursor = close ? static_cast<const char*>(close) + 1 : _end;
+            continue;
+        }
+        if (c == ';' || (c == '%' && (_cursor == _begin || _cursor[-1] == '\n'))) {
+            skipLine();
+            continue;
+        }
+        if (c == '(') { variationDepth++; _cursor++; continue; }
+        if (c == ')') { if (variationDepth > 0) variationDepth--; _cursor++; continue; }
+
+        const char* tokenStart = _cursor;
+        while (_cursor < _end && !isSpace(*_cursor) && *_cursor != '{' && *_cursor != '(' && *_cursor != ')' && *_cursor != ';') {
+            _cursor++;
+        }
+        std::string_view token(tokenStart, _cursor - tokenStart);
+
+        if (variationDepth > 0 || token.empty() || token[0] == '$' || isAnnotation(token)) continue;
+        if (isResult(token)) {
+            result = token;
+            break;
+        }
+
+        // strip a leading move number ("12." / "12...") which may be glued to the move
+        size_t skip = 0;
+        while (skip < token.size() && token[skip] >= '0' && token[skip] <= '9') skip++;
+        if (skip > 0 && skip < token.size() && token[skip] == '.') {
+            while (skip < token.size() && token[skip] == '.') skip++;
+            token.remove_prefix(skip);
+        } else if (skip == token.size()) {
+            continue;
+        }
+        if (token.empty() || !replaying) continue;
+
+        BitMove move;
+        if (!decodeSAN(_position, token, move)) {
+            _stats.badMoves++;
+            replaying = false;
+            continue;
+        }
+        if (!visitor.move(_position, move, token)) {
+            replaying = false;
+            continue;
+        }
+        _position.pushMove(move);
+        _stats.moves++;
+    }
+
+    _stats.games++;
+    if (wanted) visitor.endGame(result, _position);
+    return true;
+}
+
+bool PGNReader::decodeSAN(GameState& position, std::string_view san, BitMove& move)
+{
+    // trailing check marks and annotations
+    while (!san.empty() && (san.back() == '+' || san.back() == '#' || san.back() == '!' || san.back() == '?')) {
+        san.remove_suffix(1);
+    }
+    if (san.empty()) return false;
+
+    std::vector<BitMove> moves = position.generateAllMoves();
+
+    // castling
+    if (san == "O-O" || san == "0-0" || san == "O-O-O" || san == "0-0-0") {
+        const bool kingSide = san.size() == 3;
+        for (const BitMove& m : moves) {
+            if (m.type() == CastlingMove && (m.to() > m.from()) == kingSide) {
+                move = m;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    ChessPiece piece = Pawn;
+    switch (san[0]) {
+        case 'N': piece = Knight; break;
+        case 'B': piece = Bishop; break;
+        case 'R': piece = Rook; break;
+        case 'Q': piece = Queen; break;
+        case 'K': piece = King; break;
+        default: break;
+    }
+    if (piece != Pawn) san.remove_prefix(1);
+
+    // promotion suffix, "=Q" or a bare trailing piece letter
+    ChessPiece promotion = NoPiece;
+    if (san.size() >= 2 && std::strchr("NBRQ", san.back())) {
+        switch (san.back()) {
+            case 'N': promotion = Knight; break;
+            case 'B': promotion = Bishop; break;
+            case 'R': promotion = Rook; break;
+            default: promotion = Queen; break;
+        }
+        san.remove_suffix(1);
+        if (!san.empty() && san.back() == '=') san.remove_suffix(1);
+    }
+
+    // destination is the last two characters, anything before it disambiguates
+    if (san.size() < 2) return false;
+    char toFile = san[san.size() - 2];
+    char toRank = san[san.size() - 1];
+    if (toFile < 'a' || toFile > 'h' || toRank < '1' || toRank > '8') return false;
+    const int to = (toRank - '1') * 8 + (toFile - 'a');
+    san.remove_suffix(2);
+
+    int fromFile = -1, fromRank = -1;
+    for (char c : san) {
+        if (c >= 'a' && c <= 'h') fromFile = c - 'a';
+        else if (c >= '1' && c <= '8') fromRank = c - '1';
+        else if (c != 'x' && c != ':' && c != '-') return false;
+    }
+
+    const BitMove* found = nullptr;
+    for (const BitMove& m : moves) {
+        if (m.to() != to || position.pieceAt(m.from()) != piece) continue;
+        if (fromFile >= 0 && m.from() % 8 != fromFile) continue;
+        if (fromRank >= 0 && m.from() / 8 != fromRank) continue;
+        // a promotion without a piece letter is taken as a queen
+        if (m.type() == PromotionMove && m.promotion() != (promotion == NoPiece ? Queen : promotion)) continue;
+        if (found) return false;
+        found = &m;
+    }
+    if (!found) return false;
+
+    move = *found;
+    return true;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "GameState.h"
+#include "MappedFile.h"
+
+//
+// callbacks for PGNReader; override what you need
+//
+class PGNVisitor
+{
+public:
+    virtual ~PGNVisitor() {}
+
+    // a new game starts; return false to skip it entirely
+    virtual bool beginGame() { return true; }
+    // one tag pair, called before any moves; both views point into the PGN text
+    virtual void tag(std::string_view name, std::string_view value) {}
+    // called once the tags are read and the start position is set up;
+    // return false to skip the movetext
+    virtual bool beginMoves(const GameState& position) { return true; }
+    // a decoded move; position is the position *before* the move is made.
+    // return false to stop replaying this game
+    virtual bool move(const GameState& position, const BitMove& move, std::string_view san) { return true; }
+    // the game ended; result is "1-0", "0-1", "1/2-1/2" or "*"
+    virtual void endGame(std::string_view result, const GameState& position) {}
+};
+
+//
+// streaming PGN reader
+//
+// the file is memory mapped and scanned once; tag values and SAN tokens are
+// handed out as views into the mapping, and every move is decoded against
+// GameState::generateAllMoves and played straight into a single GameState.
+//
+class PGNReader
+{
+public:
+    struct Stats
+    {
+        uint64_t games = 0;
+        uint64_t moves = 0;
+        uint64_t badMoves = 0;      // games cut short by a move that didn't decode
+        uint64_t bytes = 0;
+    };
+
+    bool open(const std::string& path);
+    // parse text the caller owns instead of a file
+    void setText(std::string_view text);
+    void close();
+
+    // parse every game, returns the number of games seen
+    uint64_t read(PGNVisitor& visitor);
+
+    const Stats& stats() const { return _stats; }
+
+    // decode one SAN move ("Nbd7", "exd5", "e8=Q+", "O-O") in the given position
+    static bool decodeSAN(GameState& position, std::string_view san, BitMove& move);
+
+private:
+    bool readGame(PGNVisitor& visitor);
+    void skipWhitespace();
+    void skipLine();
+    bool atTag() const;
+
+    MappedFile _file;
+    const char* _begin = nullptr;
+    const char* _cursor = nullptr;
+    const char* _end = nullptr;
+    GameState _position;
+    Stats _stats;
+};
@@ -0,0 +1,81 @@
+#include "PawnTable.h"
+#include "Bitboard.h"
+#include "EvalWeights.h"
+
+PawnTable::PawnTable(size_t entries)
+{
+    size_t size = 1;
+    while (size * 2 <= entries) size *= 2;
+    // a zeroed entry stands for the board with no pawns, whose terms are all zero anyway
+    _entries.assign(size, PawnEntry{});
+    _mask = size - 1;
+}
+
+const PawnEntry& PawnTable::probe(uint64_t whitePawns, uint64_t blackPawns)
+{
+    // mix both boards into an index; the boards themselves decide a hit
+    uint64_t key = (whitePawns * 0x9E3779B97F4A7C15ULL) ^ (blackPawns * 0xC2B2AE3D27D4EB4FULL);
+    PawnEntry& entry = _entries[(key ^ (key >> 29)) & _mask];
+    _probes++;
+    if (entry.pawns[0] == whitePawns && entry.pawns[1] == blackPawns) {
+        _hits++;
+        return entry;
+    }
+    evaluate(whitePawns, blackPawns, entry);
+    return entry;
+}
+
+// one side's terms, seen from its own side (north is forward), added into terms with sign
+template <Direction Up>
+static uint64_t countSide(uint64_t ours, uint64_t theirs, int sign, PawnTerms& terms)
+{
+    constexpr Direction Down = Up == North ? South : North;
+    const uint64_t theirAttacks = Up == North ? shiftBoard<SouthWest>(theirs) | shiftBoard<SouthEast>(theirs)
+                                              : shiftBoard<NorthWest>(theirs) | shiftBoard<NorthEast>(theirs);
+    uint64_t passed = 0;
+    for (int square : BitBoard(ours)) {
+        const uint64_t pawn = squareMask(square);
+        const uint64_t file = floodFill<North>(pawn, ~0ULL) | floodFill<South>(pawn, ~0ULL);
+        const uint64_t adjacentFiles = shiftBoard<East>(file) | shiftBoard<West>(file);
+        const uint64_t ahead = floodFill<Up>(shiftBoard<Up>(pawn), ~0ULL);
+        const uint64_t behind = floodFill<Down>(pawn, ~0ULL);
+
+        if (!(theirs & (ahead | shiftBoard<East>(ahead) | shiftBoard<West>(ahead)))) {
+            passed |= pawn;
+            terms.passed[Up == North ? rankOf(square) : 7 - rankOf(square)] += sign;
+        }
+        // one penalty for each pawn with another of its own in front of it
+        if (ours & ahead) terms.doubled += sign;
+        if (!(ours & adjacentFiles)) {
+            terms.isolated += sign;
+        }
+        // no pawn beside or behind can come up to guard it, and stepping up walks into an attack
+        else if (!(ours & (shiftBoard<East>(behind) | shiftBoard<West>(behind))) &&
+                 (theirAttacks & shiftBoard<Up>(pawn))) {
+            terms.backward += sign;
+        }
+    }
+    return passed;
+}
+
+PawnTerms PawnTable::countTerms(uint64_t whitePawns, uint64_t blackPawns, uint64_t passed[2])
+{
+    PawnTerms terms{};
+    passed[0] = countSide<North>(whitePawns, blackPawns, 1, terms);
+    passed[1] = countSide<South>(blackPawns, whitePawns, -1, terms);
+    return terms;
+}
+
+int PawnTable::score(const PawnTerms& terms)
+{
+    int score = -terms.isolated * kIsolatedPenalty - terms.doubled * kDoubledPenalty - terms.backward * kBackwardPenalty;
+    for (int rank = 0; rank < 8; rank++) score += terms.passed[rank] * kPassedBonus[rank];
+    return score;
+}
+
+void PawnTable::evaluate(uint64_t whitePawns, uint64_t blackPawns, PawnEntry& entry)
+{
+    entry.pawns[0] = whitePawns;
+    entry.pawns[1] = blackPawns;
+    entry.score = score(countTerms(whitePawns, blackPawns, entry.passed));
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//
+// pawn structure evaluation behind a hash table
+//
+// pawns move rarely and never sideways without a capture, so the same pawn
+// structure comes up at a great many leaves. each entry holds the two pawn
+// bitboards it was worked out for, which makes a hit exact, along with the
+// white-relative structure score (passed, isolated, doubled and backward
+// pawns) and each side's passed pawns for terms that also depend on pieces.
+//
+
+struct PawnEntry
+{
+    uint64_t pawns[2];      // white, black
+    uint64_t passed[2];     // passed pawns of each side
+    int score;              // white-relative
+};
+
+// how many pawns of a side earn each term, white's count minus black's
+struct PawnTerms
+{
+    int passed[8];          // by rank, from the pawn's own side
+    int isolated;
+    int doubled;
+    int backward;
+};
+
+class PawnTable
+{
+public:
+    // entries is rounded down to a power of two
+    explicit PawnTable(size_t entries = 1 << 14);
+
+    // the entry for a pawn structure, worked out on a miss
+    const PawnEntry& probe(uint64_t whitePawns, uint64_t blackPawns);
+
+    uint64_t probes() const { return _probes; }
+    uint64_t hits() const { return _hits; }
+
+    // the structure terms from scratch, no table involved
+    static void evaluate(uint64_t whitePawns, uint64_t blackPawns, PawnEntry& entry);
+    // the terms counted up, and each side's passed pawns, before any weights are applied
+    static PawnTerms countTerms(uint64_t whitePawns, uint64_t blackPawns, uint64_t passed[2]);
+    // white-relative score for counted terms, with the weights in EvalWeights.h
+    static int score(const PawnTerms& terms);
+
+private:
+    std::vector<PawnEntry> _entries;
+    size_t _mask;
+    uint64_t _probes = 0;
+    uint64_t _hits = 0;
+};
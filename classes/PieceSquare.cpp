@@ -0,0 +1,167 @@
+#include "PieceSquare.h"
+#include "GameState.h"
+
+// the AVX2 kernel is built whenever the compiler can target x86, and used when the CPU has
+// AVX2 (every AVX2 CPU has popcnt too, which the kernel's material count relies on)
+#if defined(__AVX2__)
+#define PIECE_SQUARE_AVX2 1
+#define AVX2_TARGET
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define PIECE_SQUARE_AVX2 1
+#define AVX2_TARGET __attribute__((target("avx2,popcnt")))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define PIECE_SQUARE_AVX2 1
+#define AVX2_TARGET
+#include <intrin.h>
+#endif
+
+#if defined(PIECE_SQUARE_AVX2)
+#include <immintrin.h>
+#endif
+
+static constexpr int kPieceValue[7] = { 0, VAL_PAWN, VAL_KNIGHT, VAL_BISHOP, VAL_ROOK, VAL_QUEEN, VAL_KING };
+
+static constexpr int kPieceBoards[12] = {
+    WHITE_PAWNS, WHITE_KNIGHTS, WHITE_BISHOPS, WHITE_ROOKS, WHITE_QUEENS, WHITE_KING,
+    BLACK_PAWNS, BLACK_KNIGHTS, BLACK_BISHOPS, BLACK_ROOKS, BLACK_QUEENS, BLACK_KING
+};
+// the character each of those boards' pieces have in the state string
+static constexpr char kPieceCharacters[12] = { 'P', 'N', 'B', 'R', 'Q', 'K', 'p', 'n', 'b', 'r', 'q', 'k' };
+
+// per piece and square: the value plus bonus for the scalar walk, indexed by bitboard,
+// and the bonus alone in a byte for the vector sum, indexed as kPieceCharacters.
+// black's entries are negated
+struct SignedTables
+{
+    int16_t values[BLACK_KING + 1][64];
+    alignas(32) int8_t bonuses[12][64];
+};
+
+static constexpr SignedTables makeTables()
+{
+    SignedTables tables{};
+    for (int type = Pawn; type <= King; type++) {
+        for (int square = 0; square < 64; square++) {
+            const int white = kPieceSquareBonus[type][square ^ 56];
+            const int black = kPieceSquareBonus[type][square];
+            tables.values[WHITE_PAWNS + type - 1][square] = (int16_t)(kPieceValue[type] + white);
+            tables.values[BLACK_PAWNS + type - 1][square] = (int16_t)-(kPieceValue[type] + black);
+            tables.bonuses[type - 1][square] = (int8_t)white;
+            tables.bonuses[type + 5][square] = (int8_t)-black;
+        }
+    }
+    return tables;
+}
+
+static constexpr SignedTables kTables = makeTables();
+
+static constexpr bool bonusesFitBytes()
+{
+    for (int type = Pawn; type <= King; type++) {
+        for (int square = 0; square < 64; square++) {
+            if (kPieceSquareBonus[type][square] < -127 || kPieceSquareBonus[type][square] > 127) return false;
+        }
+    }
+    return true;
+}
+static_assert(bonusesFitBytes(), "the vector sum keeps square bonuses in bytes");
+
+#if defined(PIECE_SQUARE_AVX2)
+static bool cpuHasAVX2()
+{
+#if defined(__AVX2__)
+    return true;
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    // the OS has to save the ymm registers as well
+    __cpuid(info, 1);
+    if (!(info[2] & (1 << 27)) || (_xgetbv(0) & 6) != 6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    // this runs from a static initialiser, possibly ahead of libgcc's own
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+static const bool kUseAVX2 = cpuHasAVX2();
+
+// material() built for the baseline target counts bits in software, so the kernel counts its own
+AVX2_TARGET static int countBits(uint64_t bits)
+{
+#if defined(__i386__) || defined(_M_IX86)
+    return _mm_popcnt_u32((uint32_t)bits) + _mm_popcnt_u32((uint32_t)(bits >> 32));
+#else
+    return (int)_mm_popcnt_u64(bits);
+#endif
+}
+
+AVX2_TARGET static int evaluateAVX2(const GameState& position)
+{
+    // no square holds two pieces, so a byte takes at most one bonus over all twelve
+    // and the byte sums can't overflow
+    const __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(position.state));
+    const __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(position.state + 32));
+    __m256i lowSum = _mm256_setzero_si256();
+    __m256i highSum = _mm256_setzero_si256();
+    for (int piece = 0; piece < 12; piece++) {
+        const __m256i character = _mm256_set1_epi8(kPieceCharacters[piece]);
+        const int8_t* bonuses = kTables.bonuses[piece];
+        lowSum = _mm256_add_epi8(lowSum, _mm256_and_si256(_mm256_cmpeq_epi8(low, character),
+                                                          _mm256_load_si256(reinterpret_cast<const __m256i*>(bonuses))));
+        highSum = _mm256_add_epi8(highSum, _mm256_and_si256(_mm256_cmpeq_epi8(high, character),
+                                                            _mm256_load_si256(reinterpret_cast<const __m256i*>(bonuses + 32))));
+    }
+    // flipping the sign bit makes each byte bonus + 128, unsigned, for the sum of absolute differences
+    const __m256i sign = _mm256_set1_epi8((char)0x80);
+    const __m256i sums = _mm256_add_epi64(_mm256_sad_epu8(_mm256_xor_si256(lowSum, sign), _mm256_setzero_si256()),
+                                          _mm256_sad_epu8(_mm256_xor_si256(highSum, sign), _mm256_setzero_si256()));
+    __m128i sum = _mm_add_epi64(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+    sum = _mm_add_epi64(sum, _mm_unpackhi_epi64(sum, sum));
+    int material = 0;
+    for (int type = Pawn; type <= King; type++) {
+        material += kPieceValue[type] * (countBits(position._bitboards[WHITE_PAWNS + type - 1].getData()) -
+                                         countBits(position._bitboards[BLACK_PAWNS + type - 1].getData()));
+    }
+    return material + _mm_cvtsi128_si32(sum) - 64 * 128;
+}
+#endif
+
+int PieceSquare::evaluate(const GameState& position)
+{
+#if defined(PIECE_SQUARE_AVX2)
+    if (kUseAVX2) return evaluateAVX2(position);
+#endif
+    return evaluateScalar(position);
+}
+
+bool PieceSquare::vectorized()
+{
+#if defined(PIECE_SQUARE_AVX2)
+    return kUseAVX2;
+#else
+    return false;
+#endif
+}
+
+int PieceSquare::evaluateScalar(const GameState& position)
+{
+    int score = 0;
+    for (int board : kPieceBoards) {
+        for (int square : position._bitboards[board]) score += kTables.values[board][square];
+    }
+    return score;
+}
+
+int PieceSquare::material(const GameState& position)
+{
+    const BitBoard* bitboards = position._bitboards;
+    int score = 0;
+    for (int type = Pawn; type <= King; type++) {
+        score += kPieceValue[type] * (bitboards[WHITE_PAWNS + type - 1].count() - bitboards[BLACK_PAWNS + type - 1].count());
+    }
+    return score;
+}
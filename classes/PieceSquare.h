@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include "EvalWeights.h"
+#include "GameState.h"
+
+//
+// material and piece-square evaluation
+//
+// a piece is worth its material value plus a bonus for the square it stands
+// on. with AVX2 the material is a popcount per piece bitboard and the bonuses
+// a masked sum over the state string, which already spreads the board out a
+// byte per square: compare it with each piece's character and add up the bytes
+// of that piece's table under the matches, 32 squares an instruction. that
+// kernel is built for any x86 target and picked at startup when the CPU has
+// AVX2, so it doesn't wait on CHESS_NATIVE_ARCH. evaluateScalar walks the set
+// bits of each bitboard instead; it is what evaluate falls back on, and the
+// reference it's checked against (tools/pstbench).
+//
+
+namespace PieceSquare
+{
+    // these read _bitboards, so call attacks() first
+
+    // white-relative material plus square bonuses
+    int evaluate(const GameState& position);
+    int evaluateScalar(const GameState& position);
+    // true when evaluate runs the AVX2 kernel on this machine
+    bool vectorized();
+
+    // white-relative material alone
+    int material(const GameState& position);
+}
@@ -0,0 +1,184 @@
+#include "PositionIndex.h"
+#include "GameArchive.h"
+#include "GameState.h"
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+
+static bool entryLess(const PositionIndexEntry& a, const PositionIndexEntry& b)
+{
+    if (a.key != b.key) return a.key < b.key;
+    if (a.gameId != b.gameId) return a.gameId < b.gameId;
+    return a.ply < b.ply;
+}
+
+// replay one game and emit (key, game, ply) for every position it passed through
+static void indexGame(const ArchivedGame& game, uint32_t gameId, std::vector<PositionIndexEntry>& out)
+{
+    GameState state;
+    state.init(game.startState.size() == 64 ? game.startState.data() : kStartingState, WHITE);
+
+    out.push_back({ state.hash, gameId, 0, 0 });
+    for (uint32_t ply = 0; ply < game.plyCount && ply < UINT16_MAX; ply++) {
+        BitMove logged(game.move(ply));
+        if (state.pieceAt(logged.from()) == NoPiece) break;   // corrupt or non-chess record
+        state.pushMove(state.moveFor(logged.from(), logged.to(), logged.promotion()));
+        out.push_back({ state.hash, gameId, (uint16_t)(ply + 1), 0 });
+    }
+}
+
+bool PositionIndex::build(const std::string& archivePath, const std::string& indexPath, int threadCount)
+{
+    GameArchiveReader archive;
+    if (!archive.open(archivePath)) return false;
+    size_t games = archive.gameCount();
+
+    if (threadCount <= 0) threadCount = (int)std::max(1u, std::thread::hardware_concurrency());
+    threadCount = (int)std::min<size_t>(threadCount, std::max<size_t>(games, 1));
+
+    // set up the shared move generation tables once before the workers start
+    GameState warmup;
+    warmup.init(kStartingState, WHITE);
+
+    // each worker replays a contiguous slice of game ids into its own sorted run
+    std::vector<std::vector<PositionIndexEntry>> runs(threadCount);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threadCount; t++) {
+        workers.emplace_back([&, t]() {
+            size_t first = games * t / threadCount;
+            size_t last = games * (t + 1) / threadCount;
+            std::vector<PositionIndexEntry>& run = runs[t];
+            ArchivedGame game;
+            for (size_t id = first; id < last; id++) {
+                if (archive.game(id, game)) indexGame(game, (uint32_t)id, run);
+            }
+            std::sort(run.begin(), run.end(), entryLess);
+        });
+    }
+    for (std::thread& worker : workers) worker.join();
+
+    // merge the runs pairwise
+    std::vector<PositionIndexEntry> entries;
+    size_t total = 0;
+    for (const auto& run : runs) total += run.size();
+    entries.reserve(total);
+    std::vector<size_t> bounds{ 0 };
+    for (auto& run : runs) {
+        entries.insert(entries.end(), run.begin(), run.end());
+        bounds.push_back(entries.size());
+        std::vector<PositionIndexEntry>().swap(run);
+    }
+    while (bounds.size() > 2) {
+        std::vector<size_t> merged{ 0 };
+        for (size_t i = 0; i + 2 < bounds.size(); i += 2) {
+            std::inplace_merge(entries.begin() + bounds[i], entries.begin() + bounds[i + 1], entries.begin() + bounds[i + 2], entryLess);
+            merged.push_back(bounds[i + 2]);
+        }
+        if (bounds.size() % 2 == 0) merged.push_back(bounds.back());
+        bounds.swap(merged);
+    }
+
+    // a game that revisits a position only needs its first visit
+    entries.erase(std::unique(entries.begin(), entries.end(), [](const PositionIndexEntry& a, const PositionIndexEntry& b) {
+        return a.key == b.key && a.gameId == b.gameId;
+    }), entries.end());
+
+    const size_t buckets = (size_t)1 << kBucketBits;
+    std::vector<uint64_t> bucketStart(buckets + 1);
+    size_t e = 0;
+    for (size_t b = 0; b < buckets; b++) {
+        bucketStart[b] = e;
+        while (e < entries.size() && (entries[e].key >> (64 - kBucketBits)) == b) e++;
+    }
+    bucketStart[buckets] = entries.size();
+
+    PositionIndexHeader header = {};
+    header.magic = kPositionIndexMagic;
+    header.version = kPositionIndexVersion;
+    header.bucketBits = kBucketBits;
+    header.entryCount = entries.size();
+    header.gameCount = games;
+    MappedFile archiveFile;
+    header.archiveSize = archiveFile.open(archivePath) ? archiveFile.size() : 0;
+
+    // write to a temporary and rename, so a reader never maps a half written index
+    std::string tempPath = indexPath + ".tmp";
+    FILE* file = std::fopen(tempPath.c_str(), "wb");
+    if (!file) return false;
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+              std::fwrite(bucketStart.data(), sizeof(uint64_t), bucketStart.size(), file) == bucketStart.size() &&
+              std::fwrite(entries.data(), sizeof(PositionIndexEntry), entries.size(), file) == entries.size();
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok) {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    std::remove(indexPath.c_str());
+    return std::rename(tempPath.c_str(), indexPath.c_str()) == 0;
+}
+
+bool PositionIndex::open(const std::string& path)
+{
+    close();
+    if (!_file.open(path)) return false;
+
+    const uint8_t* data = _file.data();
+    const PositionIndexHeader* header = reinterpret_cast<const PositionIndexHeader*>(data);
+    size_t bucketBytes = (((size_t)1 << kBucketBits) + 1) * sizeof(uint64_t);
+    if (_file.size() < sizeof(PositionIndexHeader) + bucketBytes ||
+        header->magic != kPositionIndexMagic || header->version != kPositionIndexVersion ||
+        header->bucketBits != kBucketBits ||
+        _file.size() < sizeof(PositionIndexHeader) + bucketBytes + header->entryCount * sizeof(PositionIndexEntry)) {
+        _file.close();
+        return false;
+    }
+
+    _header = header;
+    _buckets = reinterpret_cast<const uint64_t*>(data + sizeof(PositionIndexHeader));
+    _entries = reinterpret_cast<const PositionIndexEntry*>(data + sizeof(PositionIndexHeader) + bucketBytes);
+    return true;
+}
+
+void PositionIndex::close()
+{
+    _file.close();
+    _header = nullptr;
+    _buckets = nullptr;
+    _entries = nullptr;
+}
+
+const PositionIndexEntry* PositionIndex::findFirst(uint64_t key, const PositionIndexEntry*& end) const
+{
+    size_t bucket = key >> (64 - kBucketBits);
+    const PositionIndexEntry* first = _entries + _buckets[bucket];
+    end = _entries + _buckets[bucket + 1];
+    return std::lower_bound(first, end, key, [](const PositionIndexEntry& entry, uint64_t k) {
+        return entry.key < k;
+    });
+}
+
+size_t PositionIndex::lookup(uint64_t key, std::vector<PositionPosting>& out, size_t maxResults) const
+{
+    out.clear();
+    if (!_header) return 0;
+
+    const PositionIndexEntry* end;
+    const PositionIndexEntry* entry = findFirst(key, end);
+    size_t found = 0;
+    for (; entry < end && entry->key == key; entry++, found++) {
+        if (out.size() < maxResults) out.push_back({ entry->gameId, entry->ply });
+    }
+    return found;
+}
+
+size_t PositionIndex::count(uint64_t key) const
+{
+    if (!_header) return 0;
+
+    const PositionIndexEntry* end;
+    const PositionIndexEntry* entry = findFirst(key, end);
+    const PositionIndexEntry* last = std::upper_bound(entry, end, key, [](uint64_t k, const PositionIndexEntry& e) {
+        return k < e.key;
+    });
+    return last - entry;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+
+//
+// on-disk index from position zobrist key to the archived games that reached it
+//
+// file layout (little endian):
+//   PositionIndexHeader
+//   uint64 bucketStart[kBuckets + 1]     first entry whose key's top bits are >= the bucket
+//   PositionIndexEntry entries[entryCount], sorted by key then game id
+//
+// a lookup jumps to the key's bucket and binary searches a few entries, so it
+// costs a couple of page touches no matter how many games are indexed.
+//
+
+constexpr uint32_t kPositionIndexMagic = 0x58495a43;   // "CZIX"
+constexpr uint16_t kPositionIndexVersion = 2;   // 2: keys include castling and en passant
+
+#pragma pack(push, 1)
+struct PositionIndexHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t bucketBits;
+    uint64_t entryCount;
+    uint64_t gameCount;
+    uint64_t archiveSize;   // size of the archive when indexed, to spot a stale index
+};
+
+struct PositionIndexEntry
+{
+    uint64_t key;
+    uint32_t gameId;
+    uint16_t ply;           // first ply the game reached the position
+    uint16_t reserved;
+};
+#pragma pack(pop)
+
+struct PositionPosting
+{
+    uint32_t gameId;
+    uint16_t ply;
+};
+
+class PositionIndex
+{
+public:
+    static constexpr int kBucketBits = 16;
+
+    // replay every game in the archive and write the index; threadCount 0 uses every core
+    static bool build(const std::string& archivePath, const std::string& indexPath, int threadCount = 0);
+
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return _header != nullptr; }
+
+    uint64_t entryCount() const { return _header ? _header->entryCount : 0; }
+    uint64_t gameCount() const { return _header ? _header->gameCount : 0; }
+    uint64_t archiveSize() const { return _header ? _header->archiveSize : 0; }
+
+    // games that reached the position, up to maxResults of them; returns the total number
+    size_t lookup(uint64_t key, std::vector<PositionPosting>& out, size_t maxResults = SIZE_MAX) const;
+    size_t count(uint64_t key) const;
+
+private:
+    const PositionIndexEntry* findFirst(uint64_t key, const PositionIndexEntry*& end) const;
+
+    MappedFile _file;
+    const PositionIndexHeader* _header = nullptr;
+    const uint64_t* _buckets = nullptr;
+    const PositionIndexEntry* _entries = nullptr;
+};
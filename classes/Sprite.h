@@ -36,6 +36,7 @@ public:
         _location = ImVec2(point.x - _size.x / 2, point.y - _size.y / 2);
     }
     const ImVec2 &getPosition() { return _location; }
+    const ImVec2 &getSize() { return _size; }
 
     void setSize(float x, float y)
     {
@@ -0,0 +1,757 @@
+#include "Tablebase.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <sstream>
+
+static const uint8_t kWDLMagic[4] = { 0x71, 0xe8, 0x23, 0x5d };
+static const uint8_t kDTZMagic[4] = { 0xd7, 0x66, 0x0c, 0xa5 };
+
+// flags byte at the head of each compressed stream
+enum TableFlags
+{
+    TableBlackToMove = 1,       // dtz: the side to move the table is stored for
+    TableMapped = 2,            // dtz: values go through the map
+    TableWinPlies = 4,          // dtz: wins are stored in plies rather than moves
+    TableLossPlies = 8,
+    TableWideMap = 16,          // dtz: the map has 16 bit entries
+    TableSingleValue = 128      // every position has the same value
+};
+
+// nibble of a piece type in a material signature, -1 for kings and empty squares
+static int signatureShift(char piece)
+{
+    switch (piece) {
+        case 'P': return 0;
+        case 'N': return 4;
+        case 'B': return 8;
+        case 'R': return 12;
+        case 'Q': return 16;
+        case 'p': return 20;
+        case 'n': return 24;
+        case 'b': return 28;
+        case 'r': return 32;
+        case 'q': return 36;
+        default: return -1;
+    }
+}
+
+// piece code the tables use: 1-6 for white pawn to king, 9-14 for black, so 8 swaps colour
+static int tablePiece(char piece)
+{
+    switch (piece) {
+        case 'P': return 1;  case 'p': return 9;
+        case 'N': return 2;  case 'n': return 10;
+        case 'B': return 3;  case 'b': return 11;
+        case 'R': return 4;  case 'r': return 12;
+        case 'Q': return 5;  case 'q': return 13;
+        case 'K': return 6;  case 'k': return 14;
+        default: return 0;
+    }
+}
+
+// tables are little endian, except the huffman codes which are read as a big endian bit stream
+static inline uint16_t read16(const uint8_t* data) { return (uint16_t)(data[0] | (data[1] << 8)); }
+static inline uint32_t read32(const uint8_t* data) { return read16(data) | ((uint32_t)read16(data + 2) << 16); }
+static inline uint32_t readBig32(const uint8_t* data)
+{
+    return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+}
+static inline uint64_t readBig64(const uint8_t* data) { return ((uint64_t)readBig32(data) << 32) | readBig32(data + 4); }
+
+static inline int signOf(int value) { return (value > 0) - (value < 0); }
+
+// rank less file: 0 on the a1-h8 diagonal, negative below it
+static inline int offDiagonal(int square) { return rankOf(square) - fileOf(square); }
+
+//
+// index tables
+//
+namespace
+{
+    uint64_t binomial[7][64];       // binomial[k][n]: ways to pick k of n squares
+    int mapPawns[64];               // a2-h7 to 47..0, highest for the pawn that leads
+    int mapB1H1H7[64];              // squares below the a1-h8 diagonal to 0..27
+    int mapA1D1D4[64];              // the a1-d1-d4 triangle to 0..9, the diagonal last
+    int mapKK[10][64];              // both kings, the first in the triangle, to 0..461
+    uint64_t leadPawnIndex[6][64];  // [leading pawns][square of the one that leads]
+    uint64_t leadPawnsSize[6][4];   // [leading pawns][file]
+    std::once_flag indicesBuilt;
+
+    void buildIndices()
+    {
+        int code = 0;
+        for (int square = 0; square < 64; square++) {
+            if (offDiagonal(square) < 0) mapB1H1H7[square] = code++;
+        }
+
+        std::vector<int> diagonal;
+        code = 0;
+        for (int rank = 0; rank < 4; rank++) {
+            for (int file = 0; file < 4; file++) {
+                int square = rank * 8 + file;
+                if (offDiagonal(square) < 0) mapA1D1D4[square] = code++;
+                else if (offDiagonal(square) == 0) diagonal.push_back(square);
+            }
+        }
+        for (int square : diagonal) mapA1D1D4[square] = code++;
+
+        // kings next to each other are skipped; with the first on the diagonal the second
+        // stays on or below it, and pairs with both on the diagonal come last
+        std::vector<std::pair<int, int>> bothOnDiagonal;
+        code = 0;
+        for (int index = 0; index < 10; index++) {
+            for (int first = 0; first < 28; first++) {
+                if (fileOf(first) > 3 || mapA1D1D4[first] != index || (index == 0 && first != 1)) continue;
+                for (int second = 0; second < 64; second++) {
+                    if (std::abs(fileOf(first) - fileOf(second)) <= 1 && std::abs(rankOf(first) - rankOf(second)) <= 1) continue;
+                    if (offDiagonal(first) == 0 && offDiagonal(second) > 0) continue;
+                    if (offDiagonal(first) == 0 && offDiagonal(second) == 0) bothOnDiagonal.emplace_back(index, second);
+                    else mapKK[index][second] = code++;
+                }
+            }
+        }
+        for (auto [index, second] : bothOnDiagonal) mapKK[index][second] = code++;
+
+        binomial[0][0] = 1;
+        for (int n = 1; n < 64; n++) {
+            for (int k = 0; k < 7 && k <= n; k++) {
+                binomial[k][n] = (k > 0 ? binomial[k - 1][n - 1] : 0) + (k < n ? binomial[k][n - 1] : 0);
+            }
+        }
+
+        // a pawn nearer the edge, then lower down, leads; the others can't be placed behind it
+        int available = 47;
+        for (int leading = 1; leading <= 5; leading++) {
+            for (int file = 0; file < 4; file++) {
+                uint64_t index = 0;
+                for (int rank = 1; rank <= 6; rank++) {
+                    int square = rank * 8 + file;
+                    if (leading == 1) {
+                        mapPawns[square] = available--;
+                        mapPawns[square ^ 7] = available--;
+                    }
+                    leadPawnIndex[leading][square] = index;
+                    index += binomial[leading - 1][mapPawns[square]];
+                }
+                leadPawnsSize[leading][file] = index;
+            }
+        }
+    }
+
+    bool pawnLeadsLess(int a, int b) { return mapPawns[a] < mapPawns[b]; }
+}
+
+//
+// decompression
+//
+static inline int treeLeft(const uint8_t* tree, int symbol)
+{
+    const uint8_t* entry = tree + 3 * symbol;
+    return ((entry[1] & 0xf) << 8) | entry[0];
+}
+
+static inline int treeRight(const uint8_t* tree, int symbol)
+{
+    const uint8_t* entry = tree + 3 * symbol;
+    return (entry[2] << 4) | (entry[1] >> 4);
+}
+
+// values a symbol stands for, less one; a symbol is a value or a pair of earlier symbols
+static uint8_t expandSymbol(std::vector<uint8_t>& lengths, const uint8_t* tree, int symbol, std::vector<bool>& visited)
+{
+    visited[symbol] = true;
+    int right = treeRight(tree, symbol);
+    if (right == 0xfff) return 0;
+    int left = treeLeft(tree, symbol);
+    if ((size_t)left >= lengths.size() || (size_t)right >= lengths.size()) return 0;
+    if (!visited[left]) lengths[left] = expandSymbol(lengths, tree, left, visited);
+    if (!visited[right]) lengths[right] = expandSymbol(lengths, tree, right, visited);
+    return lengths[left] + lengths[right] + 1;
+}
+
+// the stored value at an index
+int Tablebase::decompress(const PairsData& pairs, uint64_t index)
+{
+    if (pairs.flags & TableSingleValue) return pairs.minSymbolLength;
+
+    // every span values there's a sparse entry for the value halfway through: the block it's in
+    // and how far into the block. start there and walk the block lengths to ours
+    uint64_t entry = index / pairs.span;
+    uint32_t block = read32(pairs.sparseIndex + 6 * entry);
+    int offset = read16(pairs.sparseIndex + 6 * entry + 4);
+    offset += (int)(index % pairs.span) - (int)(pairs.span / 2);
+    while (offset < 0) offset += read16(pairs.blockLength + 2 * --block) + 1;
+    while (offset > read16(pairs.blockLength + 2 * block)) offset -= read16(pairs.blockLength + 2 * block++) + 1;
+
+    // canonical huffman: longer codes are numerically lower, and the codes of one length
+    // number consecutive symbols, so base[] finds the length and the symbol follows from it
+    const uint8_t* bits = pairs.data + (uint64_t)block * pairs.blockSize;
+    uint64_t buffer = readBig64(bits);
+    bits += 8;
+    int bufferBits = 64;
+    uint16_t symbol;
+    while (true) {
+        int length = 0;
+        while (buffer < pairs.base[length]) length++;
+        symbol = (uint16_t)((buffer - pairs.base[length]) >> (64 - length - pairs.minSymbolLength));
+        symbol += read16(pairs.lowestSymbol + 2 * length);
+        if (offset < pairs.symbolLength[symbol] + 1) break;
+
+        offset -= pairs.symbolLength[symbol] + 1;
+        length += pairs.minSymbolLength;
+        buffer <<= length;
+        bufferBits -= length;
+        if (bufferBits <= 32) {
+            bufferBits += 32;
+            buffer |= (uint64_t)readBig32(bits) << (64 - bufferBits);
+            bits += 4;
+        }
+    }
+
+    // then down the pairs to the value at our offset
+    while (pairs.symbolLength[symbol]) {
+        int left = treeLeft(pairs.tree, symbol);
+        if (offset < pairs.symbolLength[left] + 1) {
+            symbol = (uint16_t)left;
+        } else {
+            offset -= pairs.symbolLength[left] + 1;
+            symbol = (uint16_t)treeRight(pairs.tree, symbol);
+        }
+    }
+    return treeLeft(pairs.tree, symbol);
+}
+
+// the pieces split into groups: the leading group (the leading pawns, or the kings and a unique
+// piece, or just the kings), then runs of the same piece. each group is a factor of the index
+void Tablebase::setGroups(const Table& table, PairsData& pairs, const int order[2], int file)
+{
+    int n = 0;
+    int firstLength = table.hasPawns ? 0 : table.hasUniquePieces ? 3 : 2;
+    pairs.groupLength[n] = 1;
+    for (int i = 1; i < table.pieces; i++) {
+        if (--firstLength > 0 || pairs.pieces[i] == pairs.pieces[i - 1]) pairs.groupLength[n]++;
+        else pairs.groupLength[++n] = 1;
+    }
+    pairs.groupLength[++n] = 0;
+
+    // the file says in which order the groups multiply: order[0] is the leading group's place
+    // and order[1] the place of the other side's pawns, if it has any
+    const bool bothPawns = table.hasPawns && table.pawnCount[1];
+    int next = bothPawns ? 2 : 1;
+    int freeSquares = 64 - pairs.groupLength[0] - (bothPawns ? pairs.groupLength[1] : 0);
+    uint64_t factor = 1;
+    for (int k = 0; next < n || k == order[0] || k == order[1]; k++) {
+        if (k == order[0]) {
+            pairs.groupFactor[0] = factor;
+            factor *= table.hasPawns ? leadPawnsSize[pairs.groupLength[0]][file] : table.hasUniquePieces ? 31332 : 462;
+        } else if (k == order[1]) {
+            pairs.groupFactor[1] = factor;
+            factor *= binomial[pairs.groupLength[1]][48 - pairs.groupLength[0]];
+        } else {
+            pairs.groupFactor[next] = factor;
+            factor *= binomial[pairs.groupLength[next]][freeSquares];
+            freeSquares -= pairs.groupLength[next++];
+        }
+    }
+    pairs.groupFactor[n] = factor;
+}
+
+// the head of a compressed stream; returns where the next one starts
+const uint8_t* Tablebase::setSizes(PairsData& pairs, const uint8_t* data)
+{
+    pairs.flags = *data++;
+    if (pairs.flags & TableSingleValue) {
+        pairs.minSymbolLength = *data++;
+        return data;
+    }
+
+    int groups = 0;
+    while (pairs.groupLength[groups]) groups++;
+    const uint64_t tableSize = pairs.groupFactor[groups];
+
+    pairs.blockSize = 1ULL << *data++;
+    pairs.span = 1ULL << *data++;
+    pairs.sparseIndexCount = (tableSize + pairs.span - 1) / pairs.span;
+    const uint8_t padding = *data++;
+    pairs.blockCount = read32(data);
+    data += 4;
+    // padded so a sparse entry past the last block still points into the lengths
+    pairs.blockLengthCount = pairs.blockCount + padding;
+    const int maxSymbolLength = *data++;
+    pairs.minSymbolLength = *data++;
+    pairs.lowestSymbol = data;
+
+    // base[i] is the lowest code of length minSymbolLength + i. there are as many codes of
+    // a length as symbols between the lowest symbols of that length and the next shorter one
+    const int lengths = maxSymbolLength - pairs.minSymbolLength + 1;
+    pairs.base.assign(lengths, 0);
+    for (int i = lengths - 2; i >= 0; i--) {
+        pairs.base[i] = (pairs.base[i + 1] + read16(pairs.lowestSymbol + 2 * i) - read16(pairs.lowestSymbol + 2 * (i + 1))) / 2;
+    }
+    for (int i = 0; i < lengths; i++) pairs.base[i] <<= 64 - i - pairs.minSymbolLength;
+    data += 2 * lengths;
+
+    pairs.symbolLength.assign(read16(data), 0);
+    data += 2;
+    pairs.tree = data;
+    std::vector<bool> visited(pairs.symbolLength.size());
+    for (size_t symbol = 0; symbol < pairs.symbolLength.size(); symbol++) {
+        if (!visited[symbol]) pairs.symbolLength[symbol] = expandSymbol(pairs.symbolLength, pairs.tree, (int)symbol, visited);
+    }
+    return data + 3 * pairs.symbolLength.size() + (pairs.symbolLength.size() & 1);
+}
+
+uint64_t Tablebase::materialSignature(const GameState& position)
+{
+    uint64_t signature = 0;
+    for (int square = 0; square < 64; square++) {
+        int shift = signatureShift(position.state[square]);
+        if (shift >= 0) signature += 1ULL << shift;
+    }
+    return signature;
+}
+
+uint64_t Tablebase::materialSignature(const std::string& name)
+{
+    // "KRPvKR": white's pieces before the 'v', black's after
+    uint64_t signature = 0;
+    bool black = false;
+    for (char c : name) {
+        if (c == 'v') {
+            black = true;
+            continue;
+        }
+        int shift = signatureShift(black ? (char)std::tolower(c) : c);
+        if (shift >= 0) signature += 1ULL << shift;
+    }
+    return signature;
+}
+
+bool Tablebase::init(const std::string& paths)
+{
+    close();
+    std::call_once(indicesBuilt, buildIndices);
+
+#ifdef _WIN32
+    const char separator = ';';
+#else
+    const char separator = ':';
+#endif
+    std::stringstream list(paths);
+    std::string directory;
+    while (std::getline(list, directory, separator)) {
+        std::error_code error;
+        if (directory.empty() || !std::filesystem::is_directory(directory, error)) continue;
+        for (const auto& item : std::filesystem::directory_iterator(directory, error)) {
+            std::string extension = item.path().extension().string();
+            if (extension != ".rtbw" && extension != ".rtbz") continue;
+
+            std::string name = item.path().stem().string();
+            size_t split = name.find('v');
+            if (split == std::string::npos || name[0] != 'K' || name[split + 1] != 'K') continue;
+
+            uint64_t signature = materialSignature(name);
+            std::unique_ptr<Table>& table = _tables[signature];
+            if (!table) {
+                table = std::make_unique<Table>();
+                table->name = name;
+                table->pieces = (int)name.size() - 1;
+                table->symmetric = signature == mirrorSignature(signature);
+
+                int counts[2][7] = {};
+                for (size_t i = 0; i < name.size(); i++) {
+                    int piece = tablePiece(name[i]);
+                    if (i != split) counts[i > split][piece]++;
+                }
+                table->hasPawns = counts[0][Pawn] + counts[1][Pawn] > 0;
+                for (int side = 0; side < 2; side++) {
+                    for (int piece = Pawn; piece < King; piece++) {
+                        if (counts[side][piece] == 1) table->hasUniquePieces = true;
+                    }
+                }
+                // with pawns on both sides the side with fewer leads, as it compresses better
+                bool whiteLeads = !counts[1][Pawn] || (counts[0][Pawn] && counts[1][Pawn] >= counts[0][Pawn]);
+                table->pawnCount[0] = counts[whiteLeads ? 0 : 1][Pawn];
+                table->pawnCount[1] = counts[whiteLeads ? 1 : 0][Pawn];
+                _maxPieces = std::max(_maxPieces, table->pieces);
+            }
+            // the first directory that has the file wins
+            TableFile& file = extension == ".rtbw" ? table->wdl : table->dtz;
+            if (file.path.empty()) file.path = item.path().string();
+        }
+    }
+    return !_tables.empty();
+}
+
+void Tablebase::close()
+{
+    _tables.clear();
+    _maxPieces = 0;
+}
+
+bool Tablebase::mapTable(Table& table, bool dtz)
+{
+    TableFile& file = dtz ? table.dtz : table.wdl;
+    if (file.path.empty()) return false;
+    // map on first use; std::call_once keeps concurrent searches from racing
+    std::call_once(file.opened, [&]() {
+        if (!file.file.open(file.path)) return;
+        // every syzygy file is its 4 byte magic, then data padded so the size is 16 mod 64
+        const uint8_t* magic = dtz ? kDTZMagic : kWDLMagic;
+        const uint8_t* data = file.file.data();
+        file.valid = file.file.size() % 64 == 16 &&
+                     data[0] == magic[0] && data[1] == magic[1] && data[2] == magic[2] && data[3] == magic[3] &&
+                     readTable(table, file, dtz);
+        if (!file.valid) file.file.close();
+    });
+    return file.valid;
+}
+
+bool Tablebase::readTable(Table& table, TableFile& file, bool dtz)
+{
+    const uint8_t* start = file.file.data();
+    const uint8_t* data = start + 4;
+
+    // bit 1 of the first byte says the table has pawns
+    if (table.hasPawns != ((*data & 2) != 0)) return false;
+    data++;
+
+    const int sides = !dtz && !table.symmetric ? 2 : 1;
+    const int files = table.hasPawns ? 4 : 1;
+    const bool bothPawns = table.hasPawns && table.pawnCount[1];
+
+    // group order and piece order for each file, one nibble per side
+    for (int f = 0; f < files; f++) {
+        const int order[2][2] = { { *data & 0xf, bothPawns ? *(data + 1) & 0xf : 0xf },
+                                  { *data >> 4, bothPawns ? *(data + 1) >> 4 : 0xf } };
+        data += 1 + bothPawns;
+        for (int k = 0; k < table.pieces; k++, data++) {
+            for (int side = 0; side < sides; side++) file.pairs[side][f].pieces[k] = side ? *data >> 4 : *data & 0xf;
+        }
+        for (int side = 0; side < sides; side++) setGroups(table, file.pairs[side][f], order[side], f);
+    }
+    data += (data - start) & 1;
+
+    for (int f = 0; f < files; f++) {
+        for (int side = 0; side < sides; side++) data = setSizes(file.pairs[side][f], data);
+    }
+
+    // dtz values are stored as ranks in a per-result list of distances, when that packs better
+    if (dtz) {
+        file.map = data;
+        for (int f = 0; f < files; f++) {
+            PairsData& pairs = file.pairs[0][f];
+            if (!(pairs.flags & TableMapped)) continue;
+            if (pairs.flags & TableWideMap) {
+                data += (data - start) & 1;
+                for (int i = 0; i < 4; i++) {
+                    pairs.mapIndex[i] = (uint16_t)((data - file.map) / 2 + 1);
+                    data += 2 * read16(data) + 2;
+                }
+            } else {
+                for (int i = 0; i < 4; i++) {
+                    pairs.mapIndex[i] = (uint16_t)(data - file.map + 1);
+                    data += *data + 1;
+                }
+            }
+        }
+        data += (data - start) & 1;
+    }
+
+    for (int f = 0; f < files; f++) {
+        for (int side = 0; side < sides; side++) {
+            file.pairs[side][f].sparseIndex = data;
+            data += 6 * file.pairs[side][f].sparseIndexCount;
+        }
+    }
+    for (int f = 0; f < files; f++) {
+        for (int side = 0; side < sides; side++) {
+            file.pairs[side][f].blockLength = data;
+            data += 2 * file.pairs[side][f].blockLengthCount;
+        }
+    }
+    for (int f = 0; f < files; f++) {
+        for (int side = 0; side < sides; side++) {
+            data = start + ((data - start + 63) & ~63);
+            file.pairs[side][f].data = data;
+            data += file.pairs[side][f].blockCount * file.pairs[side][f].blockSize;
+        }
+    }
+    // a truncated or foreign file must not send a probe off the end of the mapping
+    return data <= start + file.file.size();
+}
+
+Tablebase::Table* Tablebase::findTable(const GameState& position, bool& mirrored)
+{
+    uint64_t signature = materialSignature(position);
+    // tables are named stronger side first, so a position where black is stronger is looked up with colours swapped
+    auto found = _tables.find(signature);
+    mirrored = false;
+    if (found == _tables.end()) {
+        found = _tables.find(mirrorSignature(signature));
+        mirrored = true;
+    }
+    return found == _tables.end() ? nullptr : found->second.get();
+}
+
+int Tablebase::probeTable(GameState& position, bool dtz, int wdl, ProbeResult& result)
+{
+    // bare kings have no table
+    if (position.pieceCount() == 2) return TablebaseDraw;
+
+    bool mirrored;
+    Table* table = findTable(position, mirrored);
+    if (!table || !mapTable(*table, dtz)) {
+        result = ProbeFailed;
+        return 0;
+    }
+    return decodeTable(position, *table, mirrored, dtz, wdl, result);
+}
+
+int Tablebase::decodeTable(const GameState& position, Table& table, bool mirrored, bool dtz, int wdl, ProbeResult& result)
+{
+    TableFile& file = dtz ? table.dtz : table.wdl;
+
+    // tables are stored with white the stronger side, and with white to move when both
+    // sides have the same material, so anything else is looked up with the colours swapped
+    const bool blackToMove = position.color == BLACK;
+    const bool flip = mirrored || (table.symmetric && blackToMove);
+    const int flipPiece = flip ? 8 : 0;
+    const int flipSquare = flip ? 56 : 0;
+    const int side = flip != blackToMove;
+
+    int squares[7];
+    int pieces[7];
+    int size = 0;
+    int leadPawns = 0;
+    int tableFile = 0;
+    uint64_t leadMask = 0;
+
+    // pawn tables are split by the file of the leading pawn, taken to the a-d half
+    if (table.hasPawns) {
+        const char pawn = (file.pairs[0][0].pieces[0] ^ flipPiece) == tablePiece('P') ? 'P' : 'p';
+        for (int square = 0; square < 64; square++) {
+            if (position.state[square] != pawn) continue;
+            squares[size++] = square ^ flipSquare;
+            leadMask |= squareMask(square);
+        }
+        leadPawns = size;
+        std::swap(squares[0], *std::max_element(squares, squares + leadPawns, pawnLeadsLess));
+        tableFile = std::min(fileOf(squares[0]), 7 - fileOf(squares[0]));
+    }
+
+    // a dtz table holds only one side to move
+    if (dtz) {
+        const PairsData& stored = file.pairs[0][tableFile];
+        if ((stored.flags & TableBlackToMove) != side && !(table.symmetric && !table.hasPawns)) {
+            result = ProbeOtherSide;
+            return 0;
+        }
+    }
+
+    for (int square = 0; square < 64; square++) {
+        if (position.state[square] == '0' || (leadMask & squareMask(square))) continue;
+        squares[size] = square ^ flipSquare;
+        pieces[size++] = tablePiece(position.state[square]) ^ flipPiece;
+    }
+
+    const PairsData& pairs = file.pairs[dtz ? 0 : side][tableFile];
+
+    // put the pieces in the order the table lists them
+    for (int i = leadPawns; i < size - 1; i++) {
+        for (int j = i + 1; j < size; j++) {
+            if (pairs.pieces[i] == pieces[j]) {
+                std::swap(pieces[i], pieces[j]);
+                std::swap(squares[i], squares[j]);
+                break;
+            }
+        }
+    }
+
+    // mirror the leading piece onto files a-d
+    if (fileOf(squares[0]) > 3) {
+        for (int i = 0; i < size; i++) squares[i] ^= 7;
+    }
+
+    uint64_t index;
+    if (table.hasPawns) {
+        index = leadPawnIndex[leadPawns][squares[0]];
+        std::stable_sort(squares + 1, squares + leadPawns, pawnLeadsLess);
+        for (int i = 1; i < leadPawns; i++) index += binomial[i][mapPawns[squares[i]]];
+    } else {
+        // without pawns the board also mirrors top to bottom and across the a1-h8 diagonal,
+        // which brings the leading piece into the a1-d1-d4 triangle
+        if (rankOf(squares[0]) > 3) {
+            for (int i = 0; i < size; i++) squares[i] ^= 56;
+        }
+        for (int i = 0; i < pairs.groupLength[0]; i++) {
+            if (!offDiagonal(squares[i])) continue;
+            if (offDiagonal(squares[i]) > 0) {
+                for (int j = i; j < size; j++) squares[j] = ((squares[j] >> 3) | (squares[j] << 3)) & 63;
+            }
+            break;
+        }
+
+        if (table.hasUniquePieces) {
+            // three pieces together: the first below the diagonal, or on it with the second
+            // below, or the first two on it with the third below, or all three on it
+            const int adjust1 = squares[1] > squares[0];
+            const int adjust2 = (squares[2] > squares[0]) + (squares[2] > squares[1]);
+            if (offDiagonal(squares[0])) {
+                index = (mapA1D1D4[squares[0]] * 63 + (squares[1] - adjust1)) * 62 + squares[2] - adjust2;
+            } else if (offDiagonal(squares[1])) {
+                index = (6 * 63 + rankOf(squares[0]) * 28 + mapB1H1H7[squares[1]]) * 62 + squares[2] - adjust2;
+            } else if (offDiagonal(squares[2])) {
+                index = 6 * 63 * 62 + 4 * 28 * 62 + rankOf(squares[0]) * 7 * 28 +
+                        (rankOf(squares[1]) - adjust1) * 28 + mapB1H1H7[squares[2]];
+            } else {
+                index = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28 + rankOf(squares[0]) * 7 * 6 +
+                        (rankOf(squares[1]) - adjust1) * 6 + (rankOf(squares[2]) - adjust2);
+            }
+        } else {
+            index = mapKK[mapA1D1D4[squares[0]]][squares[1]];
+        }
+    }
+
+    // each further group is a set of squares, counted past the squares taken before it
+    // (and past ranks 1 and 8 for the other side's pawns)
+    index *= pairs.groupFactor[0];
+    int* group = squares + pairs.groupLength[0];
+    bool remainingPawns = table.hasPawns && table.pawnCount[1];
+    for (int next = 1; pairs.groupLength[next]; next++) {
+        std::stable_sort(group, group + pairs.groupLength[next]);
+        uint64_t n = 0;
+        for (int i = 0; i < pairs.groupLength[next]; i++) {
+            int below = (int)std::count_if(squares, group, [&](int square) { return group[i] > square; });
+            n += binomial[i + 1][group[i] - below - 8 * remainingPawns];
+        }
+        remainingPawns = false;
+        index += n * pairs.groupFactor[next];
+        group += pairs.groupLength[next];
+    }
+
+    int value = decompress(pairs, index);
+    if (!dtz) return value - 2;
+
+    // dtz values may go through the map, and are counted in moves unless the flags say plies
+    if (pairs.flags & TableMapped) {
+        static constexpr int kMapSlot[5] = { 1, 3, 0, 2, 0 };  // by wdl + 2
+        int at = pairs.mapIndex[kMapSlot[wdl + 2]] + value;
+        value = (pairs.flags & TableWideMap) ? read16(file.map + 2 * at) : file.map[at];
+    }
+    if ((wdl == TablebaseWin && !(pairs.flags & TableWinPlies)) || (wdl == TablebaseLoss && !(pairs.flags & TableLossPlies)) ||
+        wdl == TablebaseCursedWin || wdl == TablebaseBlessedLoss) {
+        value *= 2;
+    }
+    return value + 1;
+}
+
+// dtz of a position whose best move zeroes the count, for the move before it
+static int dtzBeforeZeroing(int wdl)
+{
+    switch (wdl) {
+        case TablebaseWin: return 1;
+        case TablebaseCursedWin: return 101;
+        case TablebaseBlessedLoss: return -101;
+        case TablebaseLoss: return -1;
+        default: return 0;
+    }
+}
+
+static bool isCapture(const GameState& position, const BitMove& move)
+{
+    return position.state[move.to()] != '0' || move.type() == EnPassantMove;
+}
+
+int Tablebase::searchWDL(GameState& position, bool zeroingMoves, ProbeResult& result)
+{
+    // a table may hold anything where a capture is best (and, for a dtz probe's sake, a pawn
+    // move), so those moves are played out and the best of them weighed against the table
+    std::vector<BitMove> moves = position.generateAllMoves();
+    int best = TablebaseLoss;
+    size_t searched = 0;
+    for (const BitMove& move : moves) {
+        if (!isCapture(position, move) && (!zeroingMoves || position.pieceAt(move.from()) != Pawn)) continue;
+        searched++;
+
+        position.pushMove(move);
+        int value = -searchWDL(position, false, result);
+        position.popMove();
+        if (result == ProbeFailed) return TablebaseDraw;
+
+        if (value > best) {
+            best = value;
+            if (value >= TablebaseWin) {
+                result = ProbeZeroingBest;
+                return value;
+            }
+        }
+    }
+
+    // with every move searched the table isn't needed, and might be wrong: it knows nothing
+    // of en passant
+    const bool allSearched = searched > 0 && searched == moves.size();
+    int value = best;
+    if (!allSearched) {
+        value = probeTable(position, false, TablebaseDraw, result);
+        if (result == ProbeFailed) return TablebaseDraw;
+    }
+    if (best >= value) {
+        result = best > TablebaseDraw || allSearched ? ProbeZeroingBest : ProbeOK;
+        return best;
+    }
+    result = ProbeOK;
+    return value;
+}
+
+int Tablebase::searchDTZ(GameState& position, ProbeResult& result)
+{
+    result = ProbeOK;
+    int wdl = searchWDL(position, true, result);
+    // dtz tables don't store draws
+    if (result == ProbeFailed || wdl == TablebaseDraw) return 0;
+    if (result == ProbeZeroingBest) return dtzBeforeZeroing(wdl);
+
+    int dtz = probeTable(position, true, wdl, result);
+    if (result == ProbeFailed) return 0;
+    if (result != ProbeOtherSide) {
+        return (dtz + 100 * (wdl == TablebaseBlessedLoss || wdl == TablebaseCursedWin)) * signOf(wdl);
+    }
+
+    // the table is stored for the other side to move: a ply of search finds the move that
+    // keeps the result and brings the next capture or pawn move nearest
+    int best = 0xffff;
+    for (const BitMove& move : position.generateAllMoves()) {
+        const bool zeroing = isCapture(position, move) || position.pieceAt(move.from()) == Pawn;
+        position.pushMove(move);
+        // for a zeroing move it's the distance before it, counted from the result after it
+        dtz = zeroing ? -dtzBeforeZeroing(searchWDL(position, false, result)) : -searchDTZ(position, result);
+        if (dtz == 1 && position.isInCheck() && position.generateAllMoves().empty()) best = 1;
+        if (!zeroing) dtz += signOf(dtz);
+        if (dtz < best && signOf(dtz) == signOf(wdl)) best = dtz;
+        position.popMove();
+        if (result == ProbeFailed) return 0;
+    }
+    // no legal moves: mated
+    return best == 0xffff ? -1 : best;
+}
+
+bool Tablebase::probeWDL(GameState& position, int& wdl)
+{
+    if (position.castlingRights || position.pieceCount() > _maxPieces) return false;
+
+    ProbeResult result = ProbeOK;
+    wdl = searchWDL(position, false, result);
+    return result != ProbeFailed;
+}
+
+bool Tablebase::probeDTZ(GameState& position, int& dtz)
+{
+    if (position.castlingRights || position.pieceCount() > _maxPieces) return false;
+
+    ProbeResult result = ProbeOK;
+    dtz = searchDTZ(position, result);
+    return result != ProbeFailed;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "GameState.h"
+#include "MappedFile.h"
+
+//
+// syzygy endgame tablebases read from local files
+//
+// init() only scans the directories and records which material combinations
+// have a .rtbw (win/draw/loss) and .rtbz (distance to zeroing) file; nothing is
+// mapped until a probe first needs a table, and then only that table's file.
+// lookups go through a 40 bit material signature (piece counts per type and
+// colour), so the per-node check in the search is a hash lookup, no strings.
+//
+// a table maps each position to an index (the pieces split into groups, each
+// group placed by binomial counts, with the board mirrored so the leading
+// piece or pawn lands in a fixed corner) and stores the values in blocks,
+// compressed by recursive pairing and then canonical huffman codes. positions
+// with castling rights aren't covered, and where the best move is a capture a
+// table may hold any value that compresses well, so each probe plays out the
+// captures itself and only trusts the table for the rest.
+//
+
+enum TablebaseWDL
+{
+    TablebaseLoss = -2,
+    TablebaseBlessedLoss = -1,     // lost, but saved by the fifty-move rule
+    TablebaseDraw = 0,
+    TablebaseCursedWin = 1,        // won, but not within fifty moves
+    TablebaseWin = 2
+};
+
+class Tablebase
+{
+public:
+    // directories separated by ':' (';' on windows), like SyzygyPath; false if no tables were found
+    bool init(const std::string& paths);
+    void close();
+
+    size_t tableCount() const { return _tables.size(); }
+    // largest piece count (kings included) any table covers, 0 without tables
+    int maxPieces() const { return _maxPieces; }
+
+    // side-to-move relative results; false when the position isn't covered, which includes
+    // a table missing for a capture from it. the position is searched through its captures
+    // (and for dtz, a ply of quiet moves) and handed back as it was
+    bool probeWDL(GameState& position, int& wdl);
+    // plies to the next capture or pawn move under best play, signed like the wdl result;
+    // a hundred more for cursed wins and blessed losses, 0 for draws
+    bool probeDTZ(GameState& position, int& dtz);
+
+    // piece counts packed 4 bits each: white P N B R Q, then black p n b r q
+    static uint64_t materialSignature(const GameState& position);
+    static uint64_t materialSignature(const std::string& name);
+    static uint64_t mirrorSignature(uint64_t signature) { return (signature >> 20) | ((signature & 0xfffff) << 20); }
+
+private:
+    // one compressed stream of values: a table has one for each side to move (wdl only)
+    // and each file of the leading pawn (pawn tables only)
+    struct PairsData
+    {
+        uint8_t flags = 0;
+        uint8_t minSymbolLength = 0;        // the value itself in a single value table
+        uint64_t blockSize = 0;
+        uint64_t span = 0;                  // values between sparse index entries
+        uint32_t blockCount = 0;
+        uint32_t blockLengthCount = 0;      // blockCount plus padding
+        uint64_t sparseIndexCount = 0;
+        const uint8_t* lowestSymbol = nullptr;  // first symbol of each code length, 16 bits
+        const uint8_t* tree = nullptr;          // 3 bytes a symbol: the pair it stands for, 12 bits each
+        const uint8_t* sparseIndex = nullptr;   // 6 bytes an entry: 32 bit block, 16 bit offset
+        const uint8_t* blockLength = nullptr;   // values in each block less one, 16 bits
+        const uint8_t* data = nullptr;
+        std::vector<uint64_t> base;         // lowest code of each length, left aligned in 64 bits
+        std::vector<uint8_t> symbolLength;  // values a symbol expands to, less one
+        int pieces[7] = {};                 // piece codes in index order
+        int groupLength[8] = {};            // pieces in each group, 0 terminated
+        uint64_t groupFactor[8] = {};       // index multiplier of each group, the last is the table size
+        uint16_t mapIndex[4] = {};          // dtz only: where each result's value map starts
+    };
+    struct TableFile
+    {
+        std::string path;
+        MappedFile file;
+        std::once_flag opened;
+        bool valid = false;
+        PairsData pairs[2][4];              // [side to move][leading pawn file]
+        const uint8_t* map = nullptr;       // dtz only: stored values to distances
+    };
+    struct Table
+    {
+        std::string name;       // "KQvKR"
+        int pieces = 0;
+        bool symmetric = false; // both sides have the same material
+        bool hasPawns = false;
+        bool hasUniquePieces = false;
+        int pawnCount[2] = {};  // leading side first: the one with fewer pawns, or white
+        TableFile wdl;
+        TableFile dtz;
+    };
+    enum ProbeResult
+    {
+        ProbeFailed,
+        ProbeOK,
+        ProbeOtherSide,         // the dtz table is stored for the other side to move
+        ProbeZeroingBest        // the best move is a capture or pawn move
+    };
+
+    static void setGroups(const Table& table, PairsData& pairs, const int order[2], int file);
+    static const uint8_t* setSizes(PairsData& pairs, const uint8_t* data);
+    static int decompress(const PairsData& pairs, uint64_t index);
+
+    Table* findTable(const GameState& position, bool& mirrored);
+    bool mapTable(Table& table, bool dtz);
+    bool readTable(Table& table, TableFile& file, bool dtz);
+    int probeTable(GameState& position, bool dtz, int wdl, ProbeResult& result);
+    int decodeTable(const GameState& position, Table& table, bool mirrored, bool dtz, int wdl, ProbeResult& result);
+    int searchWDL(GameState& position, bool zeroingMoves, ProbeResult& result);
+    int searchDTZ(GameState& position, ProbeResult& result);
+
+    std::unordered_map<uint64_t, std::unique_ptr<Table>> _tables;
+    int _maxPieces = 0;
+};
@@ -0,0 +1,394 @@
+#include "Tuner.h"
+#include "Endgame.h"
+#include "EvalTerms.h"
+#include "EvalWeights.h"
+#include "MappedFile.h"
+#include "PawnTable.h"
+#include "PieceSquare.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string_view>
+#include <thread>
+
+// where each weight sits in _weights
+enum TunerWeight
+{
+    kMaterial = 0,                      // pawn .. queen, the king's never changes hands
+    kSquares = kMaterial + 5,           // pawn .. king, 64 each in EvalWeights.h order
+    kMobility = kSquares + 6 * 64,      // from here on one per count in TunerPosition
+    kKingZone,
+    kBlocked,
+    kPassed,                            // by rank, 8 of them
+    kIsolated = kPassed + 8,
+    kDoubled,
+    kBackward,
+    kWeightCount
+};
+
+static const char* const kPieceNames[7] = { "", "pawn", "knight", "bishop", "rook", "queen",
+                                           "king, kept behind its pawns while there are pieces about" };
+
+// the weights as EvalWeights.h has them, penalties counted as negative
+static std::vector<double> startingWeights()
+{
+    std::vector<double> weights(kWeightCount);
+    const int values[5] = { VAL_PAWN, VAL_KNIGHT, VAL_BISHOP, VAL_ROOK, VAL_QUEEN };
+    for (int piece = 0; piece < 5; piece++) weights[kMaterial + piece] = values[piece];
+    for (int piece = 0; piece < 6; piece++) {
+        for (int square = 0; square < 64; square++) weights[kSquares + piece * 64 + square] = kPieceSquareBonus[piece + 1][square];
+    }
+    weights[kMobility] = kMobilityWeight;
+    weights[kKingZone] = -kKingZoneAttack;
+    weights[kBlocked] = -kBlockedPassedPawn;
+    for (int rank = 0; rank < 8; rank++) weights[kPassed + rank] = kPassedBonus[rank];
+    weights[kIsolated] = -kIsolatedPenalty;
+    weights[kDoubled] = -kDoubledPenalty;
+    weights[kBackward] = -kBackwardPenalty;
+    return weights;
+}
+
+// white-relative score of a position's pieces and counts under the weights
+static double score(const uint16_t* pieces, int pieceCount, const int16_t* counts, const std::vector<double>& weights)
+{
+    double total = 0.0;
+    for (int i = 0; i < pieceCount; i++) {
+        int index = pieces[i] & 0x7fff;
+        int type = index / 64;
+        double value = weights[kSquares + index] + (type < 5 ? weights[kMaterial + type] : 0.0);
+        total += pieces[i] & 0x8000 ? -value : value;
+    }
+    for (int term = 0; term < kWeightCount - kMobility; term++) total += weights[kMobility + term] * counts[term];
+    return total;
+}
+
+// white's result at the end of a line, or in an EPD c9 opcode; 2 win, 1 draw, 0 loss, -1 if there isn't one
+static int parseResult(std::string_view line)
+{
+    std::string_view token;
+    bool bracketed = false;
+    size_t opcode = line.find("c9 \"");
+    if (opcode != std::string_view::npos) {
+        size_t first = opcode + 4;
+        size_t last = line.find('"', first);
+        if (last == std::string_view::npos) return -1;
+        token = line.substr(first, last - first);
+    } else {
+        size_t end = line.find_last_not_of(" \t");
+        if (end == std::string_view::npos) return -1;
+        size_t start = line.find_last_of(" \t", end);
+        token = line.substr(start == std::string_view::npos ? 0 : start + 1, end - start);
+        bracketed = token.size() > 2 && token.front() == '[' && token.back() == ']';
+        if (bracketed) token = token.substr(1, token.size() - 2);
+    }
+    if (token == "1-0") return 2;
+    if (token == "0-1") return 0;
+    if (token == "1/2-1/2") return 1;
+    // a bare 1 or 0 is the fullmove number of an unlabelled FEN
+    if (token == "1.0" || (bracketed && token == "1")) return 2;
+    if (token == "0.5") return 1;
+    if (token == "0.0" || (bracketed && token == "0")) return 0;
+    return -1;
+}
+
+Tuner::Tuner(const TunerOptions& options)
+    : _options(options), _weights(startingWeights())
+{
+}
+
+int Tuner::threadCount(size_t work) const
+{
+    int threads = _options.threads > 0 ? _options.threads : (int)std::max(1u, std::thread::hardware_concurrency());
+    return (int)std::min<size_t>(threads, std::max<size_t>(work, 1));
+}
+
+void Tuner::forEachSlice(const std::function<void(size_t, size_t, int)>& work) const
+{
+    // a worker per 4096 positions at least, the threads aren't free to start
+    int threads = threadCount(_positions.size() / 4096 + 1);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        size_t first = _positions.size() * t / threads;
+        size_t last = _positions.size() * (t + 1) / threads;
+        workers.emplace_back(work, first, last, t);
+    }
+    for (std::thread& worker : workers) worker.join();
+}
+
+bool Tuner::addFile(const std::string& path)
+{
+    MappedFile file;
+    if (!file.open(path, true)) return false;
+    std::string_view text(reinterpret_cast<const char*>(file.data()), (size_t)file.size());
+
+    GameState warmup;
+    warmup.init(kStartingState, WHITE);
+
+    // cut the text into one slice per worker, each starting at the beginning of a line
+    int threads = threadCount(text.size() / (1 << 20) + 1);
+    std::vector<size_t> cuts{ 0 };
+    for (int t = 1; t < threads; t++) {
+        size_t cut = text.find('\n', std::max(cuts.back(), text.size() * t / threads));
+        if (cut == std::string_view::npos) break;
+        cuts.push_back(cut + 1);
+    }
+    cuts.push_back(text.size());
+    threads = (int)cuts.size() - 1;
+
+    const std::vector<double> starting = startingWeights();
+    std::vector<std::vector<TunerPosition>> positions(threads);
+    std::vector<std::vector<uint16_t>> squares(threads);
+    std::vector<uint64_t> skipped(threads, 0);
+    std::vector<uint64_t> mismatches(threads, 0);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+            GameState position;
+            std::string_view slice = text.substr(cuts[t], cuts[t + 1] - cuts[t]);
+            while (!slice.empty()) {
+                size_t newline = slice.find('\n');
+                std::string_view line = slice.substr(0, newline);
+                slice = newline == std::string_view::npos ? std::string_view() : slice.substr(newline + 1);
+                if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+                if (line.find_first_not_of(" \t") == std::string_view::npos || line.front() == '#') continue;
+
+                int result = parseResult(line);
+                int endgame;
+                if (result < 0 || !position.initFromFEN(line) || Endgame::evaluate(position, endgame)) {
+                    skipped[t]++;
+                    continue;
+                }
+                position.attacks();
+
+                TunerPosition entry;
+                entry.firstSquare = (uint32_t)squares[t].size();
+                entry.result = (uint8_t)result;
+                for (int piece = Pawn; piece <= King; piece++) {
+                    for (int side = 0; side < 2; side++) {
+                        int board = side == 0 ? WHITE_PAWNS + piece - Pawn : BLACK_PAWNS + piece - Pawn;
+                        for (int square : position._bitboards[board]) {
+                            int index = side == 0 ? square ^ 56 : square;
+                            squares[t].push_back((uint16_t)((side << 15) | ((piece - Pawn) * 64 + index)));
+                        }
+                    }
+                }
+                entry.squareCount = (uint8_t)(squares[t].size() - entry.firstSquare);
+
+                uint64_t passed[2];
+                PawnTerms pawns = PawnTable::countTerms(position._bitboards[WHITE_PAWNS].getData(),
+                                                        position._bitboards[BLACK_PAWNS].getData(), passed);
+                int mobility = EvalTerms::mobility(position);
+                int kingZone = EvalTerms::kingZoneAttacks(position);
+                int blocked = EvalTerms::blockedPassers(position, passed);
+                entry.counts[kMobility - kMobility] = (int16_t)mobility;
+                entry.counts[kKingZone - kMobility] = (int16_t)kingZone;
+                entry.counts[kBlocked - kMobility] = (int16_t)blocked;
+                for (int rank = 0; rank < 8; rank++) entry.counts[kPassed + rank - kMobility] = (int16_t)pawns.passed[rank];
+                entry.counts[kIsolated - kMobility] = (int16_t)pawns.isolated;
+                entry.counts[kDoubled - kMobility] = (int16_t)pawns.doubled;
+                entry.counts[kBackward - kMobility] = (int16_t)pawns.backward;
+
+                // the engine's own white-relative evaluation, the way ChessAI adds it up
+                int engine = PieceSquare::evaluate(position) + mobility * kMobilityWeight - kingZone * kKingZoneAttack +
+                             PawnTable::score(pawns) - blocked * kBlockedPassedPawn;
+                double traced = score(&squares[t][entry.firstSquare], entry.squareCount, entry.counts, starting);
+                if (std::lround(traced) != engine) mismatches[t]++;
+
+                positions[t].push_back(entry);
+            }
+        });
+    }
+    for (std::thread& worker : workers) worker.join();
+
+    size_t positionTotal = _positions.size();
+    size_t squareTotal = _squares.size();
+    for (int t = 0; t < threads; t++) {
+        positionTotal += positions[t].size();
+        squareTotal += squares[t].size();
+    }
+    _positions.reserve(positionTotal);
+    _squares.reserve(squareTotal);
+    for (int t = 0; t < threads; t++) {
+        uint32_t offset = (uint32_t)_squares.size();
+        for (TunerPosition& entry : positions[t]) entry.firstSquare += offset;
+        _positions.insert(_positions.end(), positions[t].begin(), positions[t].end());
+        _squares.insert(_squares.end(), squares[t].begin(), squares[t].end());
+        std::vector<TunerPosition>().swap(positions[t]);
+        std::vector<uint16_t>().swap(squares[t]);
+        _skipped += skipped[t];
+        _mismatches += mismatches[t];
+    }
+    return true;
+}
+
+double Tuner::evaluate(const TunerPosition& position, const std::vector<double>& weights) const
+{
+    static_assert(kWeightCount - kMobility == kTermCount, "a count for every weight after the square bonuses");
+    return score(&_squares[position.firstSquare], position.squareCount, position.counts, weights);
+}
+
+// mean squared error of the expected results against the real ones, with the sigmoid scaled by K
+double Tuner::error(const std::vector<double>& weights, double scale) const
+{
+    const double factor = scale * std::log(10.0) / 400.0;
+    std::vector<double> sums(threadCount(_positions.size() / 4096 + 1), 0.0);
+    forEachSlice([&](size_t first, size_t last, int t) {
+        double sum = 0.0;
+        for (size_t i = first; i < last; i++) {
+            double expected = 1.0 / (1.0 + std::exp(-factor * evaluate(_positions[i], weights)));
+            double miss = _positions[i].result * 0.5 - expected;
+            sum += miss * miss;
+        }
+        sums[t] = sum;
+    });
+    double sum = 0.0;
+    for (double part : sums) sum += part;
+    return sum / _positions.size();
+}
+
+void Tuner::gradient(const std::vector<double>& weights, std::vector<double>& gradient) const
+{
+    const double factor = _scale * std::log(10.0) / 400.0;
+    std::vector<std::vector<double>> sums(threadCount(_positions.size() / 4096 + 1), std::vector<double>(kWeightCount, 0.0));
+    forEachSlice([&](size_t first, size_t last, int t) {
+        std::vector<double>& sum = sums[t];
+        for (size_t i = first; i < last; i++) {
+            const TunerPosition& position = _positions[i];
+            double expected = 1.0 / (1.0 + std::exp(-factor * evaluate(position, weights)));
+            // d(miss^2)/d(score), less the constant factor applied below
+            double slope = (expected - position.result * 0.5) * expected * (1.0 - expected);
+            const uint16_t* pieces = &_squares[position.firstSquare];
+            for (int p = 0; p < position.squareCount; p++) {
+                int index = pieces[p] & 0x7fff;
+                int type = index / 64;
+                double signedSlope = pieces[p] & 0x8000 ? -slope : slope;
+                sum[kSquares + index] += signedSlope;
+                if (type < 5) sum[kMaterial + type] += signedSlope;
+            }
+            for (int term = 0; term < kTermCount; term++) sum[kMobility + term] += slope * position.counts[term];
+        }
+    });
+    gradient.assign(kWeightCount, 0.0);
+    const double scale = 2.0 * factor / _positions.size();
+    for (const std::vector<double>& sum : sums) {
+        for (int w = 0; w < kWeightCount; w++) gradient[w] += sum[w] * scale;
+    }
+}
+
+bool Tuner::tune(const std::function<void(int epoch, double error)>& progress)
+{
+    if (_positions.empty()) return false;
+
+    // golden section search for the K that best fits the starting weights
+    const double golden = (std::sqrt(5.0) - 1.0) / 2.0;
+    double low = 0.05, high = 4.0;
+    double left = high - golden * (high - low), right = low + golden * (high - low);
+    double leftError = error(_weights, left), rightError = error(_weights, right);
+    while (high - low > 0.001) {
+        if (leftError < rightError) {
+            high = right;
+            right = left;
+            rightError = leftError;
+            left = high - golden * (high - low);
+            leftError = error(_weights, left);
+        } else {
+            low = left;
+            left = right;
+            leftError = rightError;
+            right = low + golden * (high - low);
+            rightError = error(_weights, right);
+        }
+    }
+    _scale = (low + high) / 2.0;
+    _initialError = error(_weights, _scale);
+    if (progress) progress(0, _initialError);
+
+    // Adam, a step of about rate centipawns per weight per epoch while the gradient keeps its sign
+    const double beta1 = 0.9, beta2 = 0.999, epsilon = 1e-8;
+    const std::vector<double> starting = startingWeights();
+    std::vector<double> momentum(kWeightCount, 0.0), velocity(kWeightCount, 0.0), slope;
+    for (int epoch = 1; epoch <= _options.epochs; epoch++) {
+        gradient(_weights, slope);
+        for (int w = 0; w < kWeightCount; w++) slope[w] += 2.0 * _options.prior * (_weights[w] - starting[w]);
+        double correction1 = 1.0 - std::pow(beta1, epoch);
+        double correction2 = 1.0 - std::pow(beta2, epoch);
+        for (int w = 0; w < kWeightCount; w++) {
+            momentum[w] = beta1 * momentum[w] + (1.0 - beta1) * slope[w];
+            velocity[w] = beta2 * velocity[w] + (1.0 - beta2) * slope[w] * slope[w];
+            _weights[w] -= _options.rate * (momentum[w] / correction1) / (std::sqrt(velocity[w] / correction2) + epsilon);
+        }
+        if (progress && (epoch % 50 == 0 || epoch == _options.epochs)) progress(epoch, error(_weights, _scale));
+    }
+    _finalError = error(_weights, _scale);
+    return true;
+}
+
+bool Tuner::writeHeader(const std::string& path) const
+{
+    // a constant added to all of a piece's square bonuses is the same as adding it to its
+    // material, so give each table back its old average and move the difference into the
+    // material. pawns only stand on ranks 2 to 7; the king's shift cancels out, both sides have one
+    double material[5];
+    int squares[7][64] = {};
+    for (int piece = 0; piece < 6; piece++) {
+        int first = piece == 0 ? 8 : 0, last = piece == 0 ? 56 : 64;
+        double tuned = 0.0, original = 0.0;
+        for (int square = first; square < last; square++) {
+            tuned += _weights[kSquares + piece * 64 + square];
+            original += kPieceSquareBonus[piece + 1][square];
+        }
+        double shift = (tuned - original) / (last - first);
+        if (piece < 5) material[piece] = _weights[kMaterial + piece] + shift;
+        for (int square = 0; square < 64; square++) {
+            // the AVX2 evaluator keeps the bonuses in signed bytes
+            int bonus = square >= first && square < last ? (int)std::lround(_weights[kSquares + piece * 64 + square] - shift) : 0;
+            squares[piece + 1][square] = std::clamp(bonus, -127, 127);
+        }
+    }
+    auto weight = [&](int index, bool penalty) { return (int)std::lround(penalty ? -_weights[index] : _weights[index]); };
+
+    FILE* out = std::fopen(path.c_str(), "w");
+    if (!out) return false;
+    std::fprintf(out, "#pragma once\n\n");
+    std::fprintf(out, "//\n// evaluation weights, in centipawns\n//\n");
+    std::fprintf(out, "// tools/tuner fits these to the results of games and writes out a file of the\n");
+    std::fprintf(out, "// same shape; put it in place of this one to build with the tuned values.\n");
+    std::fprintf(out, "// penalties are positive and get subtracted.\n//\n");
+    std::fprintf(out, "// tuned on %zu positions, K %.3f, error %.6f -> %.6f\n//\n\n",
+                 _positions.size(), _scale, _initialError, _finalError);
+
+    const char* names[5] = { "VAL_PAWN  ", "VAL_KNIGHT", "VAL_BISHOP", "VAL_ROOK  ", "VAL_QUEEN " };
+    for (int piece = 0; piece < 5; piece++) std::fprintf(out, "constexpr int %s = %d;\n", names[piece], (int)std::lround(material[piece]));
+    std::fprintf(out, "constexpr int VAL_KING   = %d;\n\n", VAL_KING);
+
+    std::fprintf(out, "// per square the knights, bishops, rooks and queens reach that their own side doesn't hold\n");
+    std::fprintf(out, "constexpr int kMobilityWeight = %d;\n", weight(kMobility, false));
+    std::fprintf(out, "// penalty for each square next to a king the other side attacks\n");
+    std::fprintf(out, "constexpr int kKingZoneAttack = %d;\n", weight(kKingZone, true));
+    std::fprintf(out, "// penalty for a passed pawn with something standing right in front of it\n");
+    std::fprintf(out, "constexpr int kBlockedPassedPawn = %d;\n\n", weight(kBlocked, true));
+
+    std::fprintf(out, "// bonus for a passed pawn by how far it has come, from its own side\n");
+    std::fprintf(out, "constexpr int kPassedBonus[8] = {");
+    for (int rank = 0; rank < 8; rank++) std::fprintf(out, "%s %d", rank ? "," : "", weight(kPassed + rank, false));
+    std::fprintf(out, " };\n");
+    std::fprintf(out, "constexpr int kIsolatedPenalty = %d;\n", weight(kIsolated, true));
+    std::fprintf(out, "constexpr int kDoubledPenalty = %d;\n", weight(kDoubled, true));
+    std::fprintf(out, "constexpr int kBackwardPenalty = %d;\n\n", weight(kBackward, true));
+
+    std::fprintf(out, "// square bonuses from white's side, written with rank 8 at the top, so a1 is entry 56\n");
+    std::fprintf(out, "constexpr int kPieceSquareBonus[7][64] = {\n    {},\n");
+    for (int piece = 1; piece <= 6; piece++) {
+        std::fprintf(out, "    {   // %s\n", kPieceNames[piece]);
+        for (int row = 0; row < 8; row++) {
+            std::fprintf(out, "        ");
+            for (int column = 0; column < 8; column++) {
+                std::fprintf(out, "%3d%s", squares[piece][row * 8 + column], column < 7 ? ", " : "");
+            }
+            std::fprintf(out, row < 7 ? ",\n" : " },\n");
+        }
+    }
+    std::fprintf(out, "};\n");
+    return std::fclose(out) == 0;
+}
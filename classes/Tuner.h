@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+//
+// texel tuning of the evaluation weights in EvalWeights.h
+//
+// the evaluation is linear in its weights: material, square bonuses,
+// mobility, king zone attacks and the pawn structure terms are each a count
+// (white's minus black's, from EvalTerms and PawnTable::countTerms) times a
+// weight. so each labelled position is read once, in parallel, and kept only
+// as its counts: two bytes per piece naming its square bonus (whose piece
+// also picks the material weight) and a short row of the other counts, under
+// a hundred bytes a position. the counts times the starting weights have to
+// come to the engine's own evaluation of the position, which catches the tuner
+// falling out of step with the evaluation.
+//
+// tune() fits the scale K of the sigmoid that turns a score into an expected
+// result, 1 / (1 + 10^(-K * score / 400)), to the starting weights, then runs
+// Adam on the mean squared error between expected and actual results over
+// every position, summing each epoch's gradient in parallel. a weight the
+// positions barely touch (a queen's square bonus in a corner) would still take
+// full Adam steps, so each is also pulled back towards where it started.
+//
+
+struct TunerOptions
+{
+    int epochs = 1000;
+    double rate = 1.0;          // Adam step size, in centipawns
+    double prior = 1e-7;        // pull towards the starting weights, per centipawn squared
+    int threads = 0;            // 0 uses every core
+};
+
+class Tuner
+{
+public:
+    explicit Tuner(const TunerOptions& options = TunerOptions());
+
+    // one position per line, a FEN and then its result: 1-0, 0-1, 1/2-1/2, or
+    // [1.0], [0.5], [0.0]; or an EPD with the result in its c9 opcode, c9 "1-0";
+    // lines with no result or a bad FEN are skipped, and so are positions the
+    // endgame evaluator scores, which no weight here touches
+    bool addFile(const std::string& path);
+
+    size_t positionCount() const { return _positions.size(); }
+    uint64_t linesSkipped() const { return _skipped; }
+    // positions whose counts didn't reproduce the engine's evaluation; should be none
+    uint64_t mismatches() const { return _mismatches; }
+
+    // fit K and then the weights, reporting the error as it goes; false with no positions
+    bool tune(const std::function<void(int epoch, double error)>& progress = nullptr);
+    double scale() const { return _scale; }
+    double initialError() const { return _initialError; }
+    double finalError() const { return _finalError; }
+
+    // the weights in the shape of EvalWeights.h; false if the file can't be written
+    bool writeHeader(const std::string& path) const;
+
+private:
+    static constexpr int kTermCount = 14;
+
+    // one labelled position as the counts the weights multiply
+    struct TunerPosition
+    {
+        uint32_t firstSquare;       // its pieces in _squares
+        uint8_t squareCount;
+        uint8_t result;             // white's: 0 loss, 1 draw, 2 win
+        int16_t counts[kTermCount]; // everything but material and square bonuses
+    };
+
+    int threadCount(size_t work) const;
+    // the positions split evenly between workers, each running work(first, last, thread)
+    void forEachSlice(const std::function<void(size_t, size_t, int)>& work) const;
+    double evaluate(const TunerPosition& position, const std::vector<double>& weights) const;
+    double error(const std::vector<double>& weights, double scale) const;
+    void gradient(const std::vector<double>& weights, std::vector<double>& gradient) const;
+
+    TunerOptions _options;
+    std::vector<TunerPosition> _positions;
+    // a piece: bit 15 set for black, then (type - 1) * 64 + its square in EvalWeights.h order
+    std::vector<uint16_t> _squares;
+    std::vector<double> _weights;
+    uint64_t _skipped = 0;
+    uint64_t _mismatches = 0;
+    double _scale = 1.0;
+    double _initialError = 0.0;
+    double _finalError = 0.0;
+};
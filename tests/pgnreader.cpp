@@ -0,0 +1,70 @@
+//
+// pgnreader: replays small PGN texts and checks what PGNReader makes of them
+//
+// exits non-zero and names the case on the first one that doesn't come out
+// as expected; run through ctest.
+//
+
+#include "../classes/PGNReader.h"
+#include <cstdio>
+#include <string>
+
+// the moves of one game in coordinates, "e2e4 e7e5 ..."
+class MoveList : public PGNVisitor
+{
+public:
+    bool move(const GameState& position, const BitMove& move, std::string_view san) override
+    {
+        if (!moves.empty()) moves += ' ';
+        moves += squareName(move.from());
+        moves += squareName(move.to());
+        return true;
+    }
+    void endGame(std::string_view gameResult, const GameState& position) override { result = gameResult; }
+
+    std::string moves;
+    std::string result;
+
+private:
+    static std::string squareName(int square) { return { char('a' + square % 8), char('1' + square / 8) }; }
+};
+
+struct ReplayCase
+{
+    const char* name;
+    const char* pgn;
+    const char* moves;
+    const char* result;
+};
+
+static const ReplayCase kCases[] = {
+    { "plain", "1. e4 e5 2. Nf3 Nc6 1-0", "e2e4 e7e5 g1f3 b8c6", "1-0" },
+    { "glued annotations", "1. e4!? e5?! 2. Nf3!! Nc6?? 1-0", "e2e4 e7e5 g1f3 b8c6", "1-0" },
+    { "annotations apart", "1. e4 !? e5 ! 2. Nf3 ?? Nc6 !! 1-0", "e2e4 e7e5 g1f3 b8c6", "1-0" },
+    { "evaluation symbols", "1. e4 e5 += 2. Nf3 +/= Nc6 =/+ 3. Bb5 +- a6 -+ 0-1", "e2e4 e7e5 g1f3 b8c6 f1b5 a7a6", "0-1" },
+    { "nags", "1. e4 $1 e5 $6 2. Nf3 $14 Nc6 1/2-1/2", "e2e4 e7e5 g1f3 b8c6", "1/2-1/2" },
+    { "comments and variations", "1. e4 {best by test} e5 (1... c5 2. Nf3) 2. Nf3 ; a rest of line comment\nNc6 *",
+      "e2e4 e7e5 g1f3 b8c6", "*" },
+    { "checks and castling", "1. e4 e5 2. Nf3 Nc6 3. Bc4 Nf6 4. O-O Bc5 5. Nxe5 Nxe5 6. d4 Bxd4 7. Qxd4 Nxc4 8. Qxc4 d5 "
+                             "9. exd5 O-O 10. Re1 Nxd5 11. Qxd5 Qxd5 12. Re8+ Rxe8 1-0",
+      "e2e4 e7e5 g1f3 b8c6 f1c4 g8f6 e1g1 f8c5 f3e5 c6e5 d2d4 c5d4 d1d4 e5c4 d4c4 d7d5 "
+      "e4d5 e8g8 f1e1 f6d5 c4d5 d8d5 e1e8 f8e8", "1-0" },
+};
+
+int main()
+{
+    int failed = 0;
+    for (const ReplayCase& test : kCases) {
+        PGNReader reader;
+        MoveList moves;
+        reader.setText(test.pgn);
+        reader.read(moves);
+        if (moves.moves != test.moves || moves.result != test.result || reader.stats().badMoves != 0) {
+            std::printf("%s: got \"%s\" %s with %llu bad moves, expected \"%s\" %s\n", test.name, moves.moves.c_str(),
+                        moves.result.c_str(), (unsigned long long)reader.stats().badMoves, test.moves, test.result);
+            failed++;
+        }
+    }
+    std::printf("%d of %zu cases failed\n", failed, sizeof(kCases) / sizeof(kCases[0]));
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,62 @@
+//
+// bookbuilder: make a polyglot opening book from game archives and PGN files
+//
+//   bookbuilder [-o book.bin] [-plies 30] [-min 2] [-threads 0] inputs...
+//
+// inputs ending in .pgn are read as PGN, anything else as a game archive (.cga).
+//
+
+#include "../classes/BookBuilder.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static bool endsWith(const std::string& text, const char* suffix)
+{
+    size_t length = std::strlen(suffix);
+    return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+}
+
+int main(int argc, char** argv)
+{
+    BookBuildOptions options;
+    std::string output = "chess_book.bin";
+    std::vector<std::string> inputs;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc) output = argv[++i];
+        else if (arg == "-plies" && i + 1 < argc) options.maxPly = std::atoi(argv[++i]);
+        else if (arg == "-min" && i + 1 < argc) options.minGames = std::atoi(argv[++i]);
+        else if (arg == "-threads" && i + 1 < argc) options.threads = std::atoi(argv[++i]);
+        else inputs.push_back(arg);
+    }
+    if (inputs.empty()) {
+        std::fprintf(stderr, "usage: %s [-o book.bin] [-plies 30] [-min 2] [-threads 0] games.cga|games.pgn ...\n", argv[0]);
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    BookBuilder builder(options);
+    for (const std::string& input : inputs) {
+        bool ok = endsWith(input, ".pgn") || endsWith(input, ".PGN") ? builder.addPGN(input) : builder.addArchive(input);
+        if (!ok) {
+            std::fprintf(stderr, "can't read %s\n", input.c_str());
+            return 1;
+        }
+    }
+    uint64_t records = builder.recordCount();
+    if (!builder.write(output)) {
+        std::fprintf(stderr, "no book written to %s (%llu moves from %llu games)\n", output.c_str(),
+                     (unsigned long long)records, (unsigned long long)builder.gamesUsed());
+        return 1;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    std::printf("%s: %llu entries from %llu moves in %llu games, %lldms\n", output.c_str(),
+                (unsigned long long)builder.entriesWritten(), (unsigned long long)records,
+                (unsigned long long)builder.gamesUsed(), (long long)elapsed.count());
+    return 0;
+}
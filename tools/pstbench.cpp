@@ -0,0 +1,214 @@
+//
+// pstbench: time the material and piece-square evaluators against each other,
+// and the NNUE evaluator against the hand-written one
+//
+//   pstbench [-positions 4096] [-passes 2000] [-seed 1] [-nnue network.nnue]
+//
+// positions come from random games off the starting position. every evaluator
+// is checked against its reference on all of them before anything is timed:
+// PieceSquare::evaluate against evaluateScalar, and the popcount
+// material against the 64-square switch loop it replaced.
+//
+// with a network, the same games are replayed the way the search sees them,
+// an accumulator update from the parent and an evaluation per move, and timed
+// against the hand-written evaluation of each position (material and squares,
+// mobility, king zone and pawn structure). every update is checked against
+// refreshing the accumulator from the board first.
+//
+
+#include "../classes/EvalTerms.h"
+#include "../classes/GameState.h"
+#include "../classes/NNUE.h"
+#include "../classes/PawnTable.h"
+#include "../classes/PieceSquare.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+// the material count as it used to be done, one square at a time
+static int switchMaterial(const char* state)
+{
+    int whiteScore = 0;
+    int blackScore = 0;
+    for (int i = 0; i < 64; ++i) {
+        int val = 0;
+        switch (state[i]) {
+            case 'P': case 'p': val = VAL_PAWN; break;
+            case 'N': case 'n': val = VAL_KNIGHT; break;
+            case 'B': case 'b': val = VAL_BISHOP; break;
+            case 'R': case 'r': val = VAL_ROOK; break;
+            case 'Q': case 'q': val = VAL_QUEEN; break;
+            case 'K': case 'k': val = VAL_KING; break;
+            default: continue;
+        }
+        if (state[i] < 'a') whiteScore += val; else blackScore += val;
+    }
+    return whiteScore - blackScore;
+}
+
+// one ply of a random game: the board before the move, and the move
+struct GamePly
+{
+    GameState before;
+    BitMove move;
+};
+
+static std::vector<GamePly> randomGames(size_t count, unsigned seed)
+{
+    std::vector<GamePly> plies(count);
+    std::mt19937 random(seed);
+    GameState game;
+    size_t found = 0;
+    while (found < count) {
+        game.init(kStartingState, WHITE);
+        for (int ply = 0; ply < 120 && found < count; ply++) {
+            std::vector<BitMove> moves = game.generateAllMoves();
+            if (moves.empty()) break;
+            // a fresh copy without the move history; attacks() brings its bitboards up to date
+            GamePly& entry = plies[found++];
+            entry.before.init(game.state, game.color);
+            entry.before.attacks();
+            entry.move = moves[random() % moves.size()];
+            game.pushMove(entry.move);
+        }
+    }
+    return plies;
+}
+
+// each ply's position after its move
+static std::vector<GameState> positionsAfter(const std::vector<GamePly>& plies)
+{
+    std::vector<GameState> positions(plies.size());
+    for (size_t i = 0; i < plies.size(); i++) {
+        GameState game = plies[i].before;
+        game.pushMove(plies[i].move);
+        positions[i].init(game.state, game.color);
+        positions[i].attacks();
+    }
+    return positions;
+}
+
+// white-relative, the sum ChessAI makes when there's no network
+static int handWritten(GameState& position)
+{
+    uint64_t passed[2];
+    PawnTerms pawns = PawnTable::countTerms(position._bitboards[WHITE_PAWNS].getData(),
+                                            position._bitboards[BLACK_PAWNS].getData(), passed);
+    return PieceSquare::evaluate(position) + EvalTerms::mobility(position) * kMobilityWeight -
+           EvalTerms::kingZoneAttacks(position) * kKingZoneAttack + PawnTable::score(pawns) -
+           EvalTerms::blockedPassers(position, passed) * kBlockedPassedPawn;
+}
+
+// the accumulator before each ply: refreshed where a game starts, updated from the ply before otherwise
+static std::vector<NNUEAccumulator> startingAccumulators(const NNUENetwork& network, const std::vector<GamePly>& plies)
+{
+    std::vector<NNUEAccumulator> accumulators(plies.size());
+    for (size_t i = 0; i < plies.size(); i++) {
+        if (i > 0 && std::memcmp(plies[i].before.state, kStartingState, 64) != 0) {
+            network.update(plies[i - 1].before, plies[i - 1].move, accumulators[i - 1], accumulators[i]);
+        } else {
+            network.refresh(plies[i].before, accumulators[i]);
+        }
+    }
+    return accumulators;
+}
+
+// nanoseconds per position over all the passes; the sum keeps the work from being optimised away
+template <typename Evaluate>
+static double timePasses(std::vector<GameState>& positions, int passes, Evaluate evaluate, long long& sum)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < passes; pass++) {
+        for (GameState& position : positions) sum += evaluate(position);
+    }
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start);
+    return elapsed.count() / ((double)passes * positions.size());
+}
+
+int main(int argc, char** argv)
+{
+    size_t count = 4096;
+    int passes = 2000;
+    unsigned seed = 1;
+    std::string networkPath;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-positions" && i + 1 < argc) count = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "-passes" && i + 1 < argc) passes = std::atoi(argv[++i]);
+        else if (arg == "-seed" && i + 1 < argc) seed = (unsigned)std::atoi(argv[++i]);
+        else if (arg == "-nnue" && i + 1 < argc) networkPath = argv[++i];
+        else {
+            std::fprintf(stderr, "usage: %s [-positions 4096] [-passes 2000] [-seed 1] [-nnue network.nnue]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (count == 0 || passes <= 0) {
+        std::fprintf(stderr, "nothing to time\n");
+        return 1;
+    }
+
+    NNUENetwork network;
+    if (!networkPath.empty() && !network.load(networkPath)) {
+        std::fprintf(stderr, "can't load a network from %s\n", networkPath.c_str());
+        return 1;
+    }
+
+    std::vector<GamePly> plies = randomGames(count, seed);
+    std::vector<GameState> positions = positionsAfter(plies);
+    for (const GameState& position : positions) {
+        if (PieceSquare::evaluate(position) != PieceSquare::evaluateScalar(position) ||
+            PieceSquare::material(position) != switchMaterial(position.state)) {
+            std::fprintf(stderr, "evaluators disagree on %.64s\n", position.state);
+            return 1;
+        }
+    }
+
+    const char* kernel = PieceSquare::vectorized() ? "AVX2" : "scalar";
+    long long sum = 0;
+    double switchLoop = timePasses(positions, passes, [](const GameState& p) { return switchMaterial(p.state); }, sum);
+    double popcount = timePasses(positions, passes, [](const GameState& p) { return PieceSquare::material(p); }, sum);
+    double scalar = timePasses(positions, passes, [](const GameState& p) { return PieceSquare::evaluateScalar(p); }, sum);
+    double vector = timePasses(positions, passes, [](const GameState& p) { return PieceSquare::evaluate(p); }, sum);
+
+    std::printf("%zu positions x %d passes (checksum %lld)\n", positions.size(), passes, sum);
+    std::printf("material, 64-square switch       %7.2f ns\n", switchLoop);
+    std::printf("material, popcount               %7.2f ns  %5.2fx\n", popcount, switchLoop / popcount);
+    std::printf("material + squares, scalar       %7.2f ns\n", scalar);
+    std::printf("material + squares, %-6s        %7.2f ns  %5.2fx over scalar, %5.2fx over the switch\n",
+                kernel, vector, scalar / vector, switchLoop / vector);
+    if (!network.isLoaded()) return 0;
+
+    // the accumulators before each ply, and a check that updating lands where refreshing does
+    std::vector<NNUEAccumulator> accumulators = startingAccumulators(network, plies);
+    for (size_t i = 0; i < plies.size(); i++) {
+        NNUEAccumulator updated, refreshed;
+        network.update(plies[i].before, plies[i].move, accumulators[i], updated);
+        network.refresh(positions[i], refreshed);
+        if (std::memcmp(&updated, &refreshed, sizeof(updated)) != 0) {
+            std::fprintf(stderr, "update and refresh disagree after a move from %.64s\n", plies[i].before.state);
+            return 1;
+        }
+    }
+
+    // the update writes to a scratch accumulator, so each ply times the same work every pass
+    NNUEAccumulator child;
+    double hand = timePasses(positions, passes, [](GameState& p) { return handWritten(p); }, sum);
+    auto start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < passes; pass++) {
+        for (size_t i = 0; i < plies.size(); i++) {
+            network.update(plies[i].before, plies[i].move, accumulators[i], child);
+            sum += network.evaluate(child, positions[i].color);
+        }
+    }
+    double nnue = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                  ((double)passes * plies.size());
+
+    std::printf("hand-written evaluation          %7.2f ns  (checksum %lld)\n", hand, sum);
+    std::printf("nnue update + evaluate, %-6s    %7.2f ns  %5.2fx the hand-written cost\n",
+                NNUENetwork::kernel(), nnue, nnue / hand);
+    return 0;
+}
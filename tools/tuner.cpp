@@ -0,0 +1,74 @@
+//
+// tuner: fit the evaluation weights in EvalWeights.h to labelled positions
+//
+//   tuner [-o EvalWeights.h] [-epochs 1000] [-rate 1.0] [-prior 1e-7] [-threads 0] positions.txt ...
+//
+// each line is a FEN followed by white's result (1-0, 0-1, 1/2-1/2 or [1.0],
+// [0.5], [0.0]), or an EPD with it in a c9 opcode (c9 "1-0";). quiet
+// positions tune best: the weights are fitted to the static evaluation, which
+// knows nothing of a capture about to happen. the output has the shape of
+// classes/EvalWeights.h and goes in its place.
+//
+
+#include "../classes/Tuner.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+    TunerOptions options;
+    std::string output = "EvalWeights.h";
+    std::vector<std::string> inputs;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc) output = argv[++i];
+        else if (arg == "-epochs" && i + 1 < argc) options.epochs = std::atoi(argv[++i]);
+        else if (arg == "-rate" && i + 1 < argc) options.rate = std::atof(argv[++i]);
+        else if (arg == "-prior" && i + 1 < argc) options.prior = std::atof(argv[++i]);
+        else if (arg == "-threads" && i + 1 < argc) options.threads = std::atoi(argv[++i]);
+        else inputs.push_back(arg);
+    }
+    if (inputs.empty()) {
+        std::fprintf(stderr, "usage: %s [-o EvalWeights.h] [-epochs 1000] [-rate 1.0] [-prior 1e-7] [-threads 0] positions.txt ...\n", argv[0]);
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    Tuner tuner(options);
+    for (const std::string& input : inputs) {
+        if (!tuner.addFile(input)) {
+            std::fprintf(stderr, "can't read %s\n", input.c_str());
+            return 1;
+        }
+    }
+    auto loaded = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    std::printf("%zu positions, %llu lines skipped, %lldms\n", tuner.positionCount(),
+                (unsigned long long)tuner.linesSkipped(), (long long)loaded.count());
+    if (tuner.mismatches() > 0) {
+        std::fprintf(stderr, "%llu positions don't add up to the engine's evaluation, the tuner is out of date\n",
+                     (unsigned long long)tuner.mismatches());
+        return 1;
+    }
+
+    bool tuned = tuner.tune([&](int epoch, double error) {
+        if (epoch == 0) std::printf("K %.3f\n", tuner.scale());
+        std::printf("epoch %5d  error %.6f\n", epoch, error);
+        std::fflush(stdout);
+    });
+    if (!tuned) {
+        std::fprintf(stderr, "no positions to tune on\n");
+        return 1;
+    }
+    if (!tuner.writeHeader(output)) {
+        std::fprintf(stderr, "can't write %s\n", output.c_str());
+        return 1;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    std::printf("%s: error %.6f -> %.6f, %lldms\n", output.c_str(), tuner.initialError(), tuner.finalError(),
+                (long long)elapsed.count());
+    return 0;
+}